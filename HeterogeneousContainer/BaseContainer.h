@@ -1,17 +1,93 @@
 #pragma once
 
+#include "Instrumentation.h"
+#include <stddef.h>
 #include <istream>
 #include <ostream>
+#include <type_traits>
+#include <utility>
 
 template <typename T>
 using Condition = bool(*)(const T&);
 
+//Enables the predicate overloads only for callables that take const T& and return bool, so they
+//never compete with the overloads that take an element
+template <typename Predicate, typename T>
+using EnableIfPredicate = typename std::enable_if<
+	std::is_convertible<decltype(std::declval<Predicate&>()(std::declval<const T&>())), bool>::value>::type;
+
+//Non owning reference to any predicate - a function, a capturing lambda or a functor. The virtual interface
+//takes it, so a call through BaseContainer costs one indirect call per element; the concrete containers also
+//have template overloads that inline the predicate into their scans. It must not outlive the predicate.
+template <typename T>
+class PredicateRef
+{
+public:
+	PredicateRef(Condition<T> function)
+		: function(function), invoke(&call_function)
+	{}
+
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	PredicateRef(const Predicate &predicate)
+		: object(&predicate), invoke(&call_object<Predicate>)
+	{}
+
+	bool operator()(const T &element) const
+	{
+		return invoke(*this, element);
+	}
+
+private:
+	static bool call_function(const PredicateRef<T> &ref, const T &element)
+	{
+		return ref.function(element);
+	}
+
+	template <typename Predicate>
+	static bool call_object(const PredicateRef<T> &ref, const T &element)
+	{
+		return (*static_cast<const Predicate*>(ref.object))(element);
+	}
+
+	union
+	{
+		Condition<T> function;
+		const void *object;
+	};
+	bool (*invoke)(const PredicateRef<T>&, const T&);
+};
+
+//Bytes held by a container. The payload is sizeof(T) for every element - memory owned by the elements
+//themselves (the characters of a string) is not followed; the overhead is everything kept next to the
+//elements - node links, bookkeeping and the container object; the slack is memory taken from the system
+//but not used yet - free buffer or pool slots. The allocator's own headers are not known, so not counted.
+struct MemoryUsage
+{
+	size_t payload = 0;
+	size_t overhead = 0;
+	size_t slack = 0;
+
+	size_t total() const
+	{
+		return payload + overhead + slack;
+	}
+
+	MemoryUsage& operator+=(const MemoryUsage &other)
+	{
+		payload += other.payload;
+		overhead += other.overhead;
+		slack += other.slack;
+
+		return *this;
+	}
+};
+
 template <typename T>
 class BaseIterator
 {
 public:
 	virtual void next() = 0;
-	virtual T value() const = 0;
+	virtual const T& value() const = 0; //valid until the container is modified
 	virtual bool are_equal(BaseIterator<T>*) const = 0;
 	virtual BaseIterator<T>* clone() const = 0;
 	
@@ -25,23 +101,96 @@ class BaseContainer
 {
 public:
 	virtual bool contains(const T&) const = 0;
-	virtual bool contains(Condition<T>) const = 0;
-	virtual void filter(Condition<T>) = 0;
+	virtual bool contains(PredicateRef<T>) const = 0;
+	virtual void filter(PredicateRef<T>) = 0;
 	virtual void sort() = 0;
 	virtual void push(const T&) = 0;
+	virtual void push(T&&) = 0;
 	virtual T pop() = 0;
+	//builds the element from the arguments and moves it in; the concrete containers build it in place
+	template <typename... Args>
+	void emplace(Args&&...);
+	//pushes amount elements starting at first in their order, with the same result as pushing them one by one;
+	//containers that can take a whole batch at once override it
+	virtual void push_range(const T *first, size_t amount);
 	virtual size_t size() const = 0;
 	virtual short id() const = 0;
 	virtual bool empty() const = 0;
 	virtual BaseContainer<T>* clone() const = 0;
+	virtual MemoryUsage memory_usage() const = 0; //in O(1)
 
 	//default value true is going to be used in the regular operations; false is going to be used for serialization purposes
 	virtual BaseIterator<T>* begin(bool = true) const = 0;
 	virtual BaseIterator<T>* end() const = 0;
 
+	//Regular iterator to the first element that is not smaller (upper_bound - greater) than the given one;
+	//skipped is set to the amount of elements before it. The container should be sorted. By default
+	//the elements are walked one by one, the containers that can seek directly override them.
+	virtual BaseIterator<T>* lower_bound(const T&, size_t &skipped) const;
+	virtual BaseIterator<T>* upper_bound(const T&, size_t &skipped) const;
+
+#ifdef HETERO_INSTRUMENTATION
+	const Instrumentation::Counters& counters() const;
+	void reset_counters();
+#endif
+
 	virtual ~BaseContainer();
+
+#ifdef HETERO_INSTRUMENTATION
+protected:
+	mutable Instrumentation::Counters operationCounters; //see Instrumentation.h
+#endif
 };
 
+template<typename T>
+template<typename... Args>
+inline void BaseContainer<T>::emplace(Args&&... args)
+{
+	push(T(std::forward<Args>(args)...));
+}
+
+template<typename T>
+inline void BaseContainer<T>::push_range(const T *first, size_t amount)
+{
+	for (size_t ind = 0; ind < amount; ind++) push(first[ind]);
+}
+
+template<typename T>
+inline BaseIterator<T>* BaseContainer<T>::lower_bound(const T &element, size_t &skipped) const
+{
+	BaseIterator<T> *it = begin();
+	BaseIterator<T> *end = this->end();
+	for (skipped = 0; !it->are_equal(end) && it->value() < element; it->next()) ++skipped;
+	delete end;
+
+	return it;
+}
+
+template<typename T>
+inline BaseIterator<T>* BaseContainer<T>::upper_bound(const T &element, size_t &skipped) const
+{
+	BaseIterator<T> *it = begin();
+	BaseIterator<T> *end = this->end();
+	for (skipped = 0; !it->are_equal(end) && !(element < it->value()); it->next()) ++skipped;
+	delete end;
+
+	return it;
+}
+
+#ifdef HETERO_INSTRUMENTATION
+template<typename T>
+inline const Instrumentation::Counters & BaseContainer<T>::counters() const
+{
+	return operationCounters;
+}
+
+template<typename T>
+inline void BaseContainer<T>::reset_counters()
+{
+	operationCounters = Instrumentation::Counters();
+}
+#endif
+
 template<typename T>
 inline BaseContainer<T>::~BaseContainer()
 {}
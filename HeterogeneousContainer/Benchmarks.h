@@ -0,0 +1,466 @@
+#pragma once
+
+#include "Stack.h"
+#include "Queue.h"
+#include "DoublyLinkedList.h"
+#include "BinSearchTree.h"
+#include "HeteroContainer.h"
+#include "StaticHeteroContainer.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Benchmark suite. Every measurement is a record that is printed as one line of text and can also be written as CSV
+//or JSON for regression tracking. The sweeps cover the element count, the subcontainer count and the key distribution.
+//Plain (not self balancing) trees are measured on uniform keys only - sorted or repeated keys turn them into lists.
+
+struct BenchmarkOptions
+{
+	bool quick; //the small sizes only - a smoke run that finishes in seconds
+	std::string csvFile; //no file when empty
+	std::string jsonFile;
+
+	BenchmarkOptions() : quick(false) {}
+};
+
+enum KeyDistribution
+{
+	UNIFORM = 0,
+	SORTED = 1,
+	REVERSED = 2,
+	FEW_DISTINCT = 3 //64 different keys
+};
+
+struct BenchmarkRecord
+{
+	std::string suite;
+	std::string subject;
+	std::string operation;
+	std::string distribution;
+	size_t elements;
+	size_t containers;
+	size_t operations; //the amount of operations in the measured time
+	double milliseconds;
+};
+
+class BenchmarkReport
+{
+public:
+	void add(const char *suite, const std::string &subject, const char *operation, const char *distribution,
+		size_t elements, size_t containers, size_t operations, double milliseconds);
+
+	void write_csv(std::ostream&) const;
+	void write_json(std::ostream&) const;
+
+private:
+	std::vector<BenchmarkRecord> records;
+};
+
+inline void BenchmarkReport::add(const char *suite, const std::string &subject, const char *operation, const char *distribution,
+	size_t elements, size_t containers, size_t operations, double milliseconds)
+{
+	BenchmarkRecord record = { suite, subject, operation, distribution, elements, containers, operations, milliseconds };
+	records.push_back(record);
+
+	//formatted on the side, so std::cout keeps its flags
+	std::ostringstream line;
+	line << std::left << std::setw(10) << suite << std::setw(24) << subject << std::setw(28) << operation <<
+		std::setw(14) << distribution << std::right << std::setw(8) << elements << " elements " << std::setw(3) << containers <<
+		" containers " << std::fixed << std::setprecision(3) << std::setw(11) << milliseconds << " ms " <<
+		std::setprecision(1) << std::setw(10) << milliseconds * 1e6 / operations << " ns/op\n";
+	std::cout << line.str();
+}
+
+inline void BenchmarkReport::write_csv(std::ostream &outStr) const
+{
+	outStr << "suite,subject,operation,distribution,elements,containers,operations,milliseconds,ns_per_operation\n";
+	for (const BenchmarkRecord &record : records)
+	{
+		outStr << record.suite << "," << record.subject << "," << record.operation << "," << record.distribution << "," <<
+			record.elements << "," << record.containers << "," << record.operations << "," <<
+			record.milliseconds << "," << record.milliseconds * 1e6 / record.operations << "\n";
+	}
+}
+
+inline void BenchmarkReport::write_json(std::ostream &outStr) const
+{
+	//the names are plain identifiers, so they need no escaping
+	outStr << "{\n  \"benchmarks\": [";
+	for (size_t ind = 0; ind < records.size(); ind++)
+	{
+		const BenchmarkRecord &record = records[ind];
+		outStr << (ind == 0 ? "\n" : ",\n") << "    {\"suite\": \"" << record.suite << "\", \"subject\": \"" << record.subject <<
+			"\", \"operation\": \"" << record.operation << "\", \"distribution\": \"" << record.distribution <<
+			"\", \"elements\": " << record.elements << ", \"containers\": " << record.containers <<
+			", \"operations\": " << record.operations << ", \"milliseconds\": " << record.milliseconds <<
+			", \"ns_per_operation\": " << record.milliseconds * 1e6 / record.operations << "}";
+	}
+	outStr << "\n  ]\n}\n";
+}
+
+//the results of the measured loops end up here, so the compiler cannot drop the loops
+volatile long long benchmarkSink = 0;
+
+const size_t BENCHMARK_LOOKUPS = 100;
+
+template <typename Function>
+double measure_milliseconds(Function function)
+{
+	auto start = std::chrono::steady_clock::now();
+	function();
+	auto finish = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::milli>(finish - start).count();
+}
+
+const char* distribution_name(KeyDistribution distribution)
+{
+	switch (distribution)
+	{
+	case UNIFORM: return "uniform";
+	case SORTED: return "sorted";
+	case REVERSED: return "reversed";
+	case FEW_DISTINCT: return "few_distinct";
+	default: return "unknown";
+	}
+}
+
+//non negative keys from a fixed seed; mt19937 is the same everywhere, so are the keys
+std::vector<int> make_keys(KeyDistribution distribution, size_t amount)
+{
+	std::mt19937 generator(42);
+	std::vector<int> keys(amount);
+	for (size_t ind = 0; ind < amount; ind++)
+	{
+		switch (distribution)
+		{
+		case UNIFORM: keys[ind] = (int)(generator() >> 1);
+			break;
+		case SORTED: keys[ind] = (int)ind * 2;
+			break;
+		case REVERSED: keys[ind] = (int)(amount - ind) * 2;
+			break;
+		case FEW_DISTINCT: keys[ind] = (int)(generator() >> 1) % 64;
+			break;
+		}
+	}
+
+	return keys;
+}
+
+//every second lookup is a key of the container, the others are negative and missing
+int lookup_key(const std::vector<int> &keys, size_t ind)
+{
+	return ind % 2 == 0 ? keys[ind * 7919 % keys.size()] : -1 - (int)ind;
+}
+
+bool IsMultipleOfThree(const int &key)
+{
+	return key % 3 == 0;
+}
+
+template <typename Container>
+void benchmark_container(BenchmarkReport &report, const char *name, const Container &empty, const std::vector<int> &keys, KeyDistribution distribution)
+{
+	const char *keysName = distribution_name(distribution);
+	size_t amount = keys.size();
+
+	Container container(empty);
+	double push = measure_milliseconds([&container, &keys]() { for (int key : keys) container.push(key); });
+	report.add("container", name, "push", keysName, amount, 1, amount, push);
+
+	double contains = measure_milliseconds([&container, &keys]()
+	{
+		for (size_t ind = 0; ind < BENCHMARK_LOOKUPS; ind++) benchmarkSink += container.contains(lookup_key(keys, ind));
+	});
+	report.add("container", name, "contains", keysName, amount, 1, BENCHMARK_LOOKUPS, contains);
+
+	double iteration = measure_milliseconds([&container]()
+	{
+		BaseIterator<int> *it = container.begin();
+		BaseIterator<int> *end = container.end();
+		for (; !it->are_equal(end); it->next()) benchmarkSink += it->value();
+		delete it;
+		delete end;
+	});
+	report.add("container", name, "iteration", keysName, amount, 1, amount, iteration);
+
+	double sort = measure_milliseconds([&container]() { container.sort(); });
+	report.add("container", name, "sort", keysName, amount, 1, amount, sort);
+
+	Container filtered(container);
+	double filter = measure_milliseconds([&filtered]() { filtered.filter(IsMultipleOfThree); });
+	report.add("container", name, "filter", keysName, amount, 1, amount, filter);
+
+	double pop = measure_milliseconds([&container]() { while (!container.empty()) benchmarkSink += container.pop(); });
+	report.add("container", name, "pop", keysName, amount, 1, amount, pop);
+}
+
+void BenchmarkContainers(BenchmarkReport &report, const std::vector<size_t> &amounts)
+{
+	KeyDistribution distributions[] = { UNIFORM, SORTED, REVERSED, FEW_DISTINCT };
+	for (KeyDistribution distribution : distributions)
+	{
+		for (size_t amount : amounts)
+		{
+			std::vector<int> keys = make_keys(distribution, amount);
+
+			benchmark_container(report, "Stack", Stack<int>(), keys, distribution);
+			benchmark_container(report, "Queue", Queue<int>(), keys, distribution);
+			benchmark_container(report, "DoublyLinkedList", DoublyLinkedList<int>(), keys, distribution);
+			benchmark_container(report, "BinSearchTree(AVL)", BinSearchTree<int>(true), keys, distribution);
+			if (distribution == UNIFORM) benchmark_container(report, "BinSearchTree", BinSearchTree<int>(), keys, distribution);
+		}
+	}
+}
+
+//the subcontainer types take turns; plain trees are left out, see the top of the file
+HeteroContainer<int> hetero_with_containers(size_t containers)
+{
+	HeteroContainer<int>::Type types[] = { HeteroContainer<int>::STACK, HeteroContainer<int>::QUEUE,
+		HeteroContainer<int>::LINKED_LIST, HeteroContainer<int>::BALANCED_BIN_SEARCH_TREE };
+
+	HeteroContainer<int> result;
+	for (size_t ind = 0; ind < containers; ind++) result.add_container(types[ind % 4]);
+
+	return result;
+}
+
+void BenchmarkHetero(BenchmarkReport &report, const std::vector<size_t> &amounts, const std::vector<size_t> &containerCounts)
+{
+	KeyDistribution distributions[] = { UNIFORM, SORTED, REVERSED, FEW_DISTINCT };
+	for (KeyDistribution distribution : distributions)
+	{
+		const char *keysName = distribution_name(distribution);
+		for (size_t amount : amounts)
+		{
+			std::vector<int> keys = make_keys(distribution, amount);
+			for (size_t containers : containerCounts)
+			{
+				HeteroContainer<int> cont = hetero_with_containers(containers);
+				double single = measure_milliseconds([&cont, &keys]() { for (int key : keys) cont.add_element(key); });
+				report.add("hetero", "HeteroContainer", "add_element", keysName, amount, containers, amount, single);
+
+				HeteroContainer<int> batch = hetero_with_containers(containers);
+				double bulk = measure_milliseconds([&batch, &keys]() { batch.add_elements(keys.data(), keys.size()); });
+				report.add("hetero", "HeteroContainer", "add_elements", keysName, amount, containers, amount, bulk);
+
+				double contains = measure_milliseconds([&cont, &keys]()
+				{
+					for (size_t ind = 0; ind < BENCHMARK_LOOKUPS; ind++) benchmarkSink += cont.contains(lookup_key(keys, ind));
+				});
+				report.add("hetero", "HeteroContainer", "contains", keysName, amount, containers, BENCHMARK_LOOKUPS, contains);
+
+				//the keys are never negative, so every lookup misses; then the same with the membership filters
+				//(built by the first lookup, which is not measured)
+				auto lookupMissing = [&batch]()
+				{
+					for (size_t ind = 0; ind < BENCHMARK_LOOKUPS; ind++) benchmarkSink += batch.contains(-1 - (int)ind);
+				};
+				report.add("hetero", "HeteroContainer", "contains_missing", keysName, amount, containers, BENCHMARK_LOOKUPS, measure_milliseconds(lookupMissing));
+				batch.use_membership_filters();
+				benchmarkSink += batch.contains(-1);
+				report.add("hetero", "HeteroContainer", "contains_missing_filtered", keysName, amount, containers, BENCHMARK_LOOKUPS, measure_milliseconds(lookupMissing));
+
+				double sort = measure_milliseconds([&cont]() { cont.sort(); });
+				report.add("hetero", "HeteroContainer", "sort", keysName, amount, containers, amount, sort);
+
+				double merge = measure_milliseconds([&cont]()
+				{
+					HeteroContainer<int>::SortIterator end = cont.end();
+					for (HeteroContainer<int>::SortIterator it = cont.begin(); it != end; ++it) benchmarkSink += *it;
+				});
+				report.add("hetero", "HeteroContainer", "sort_iterator", keysName, amount, containers, amount, merge);
+
+				bool orders[] = { true, false };
+				for (bool inDepth : orders)
+				{
+					double walk = measure_milliseconds([&cont, inDepth]()
+					{
+						HeteroContainer<int>::SpecificIterator end = cont.specific_end(inDepth);
+						for (HeteroContainer<int>::SpecificIterator it = cont.specific_begin(inDepth); it != end; ++it) benchmarkSink += *it;
+					});
+					report.add("hetero", "HeteroContainer", inDepth ? "specific_iterator_depth" : "specific_iterator_breadth",
+						keysName, amount, containers, amount, walk);
+				}
+
+				double filter = measure_milliseconds([&cont]() { cont.filter(IsMultipleOfThree); });
+				report.add("hetero", "HeteroContainer", "filter", keysName, amount, containers, amount, filter);
+			}
+		}
+	}
+}
+
+template <typename Container>
+double queue_churn(size_t amount)
+{
+	Container queue;
+	return measure_milliseconds([&queue, amount]()
+	{
+		for (size_t round = 0; round < 100; round++)
+		{
+			for (size_t ind = 0; ind < amount; ind++) queue.push((int)ind);
+			while (!queue.empty()) queue.pop();
+		}
+	});
+}
+
+void BenchmarkQueueChurn(BenchmarkReport &report, const std::vector<size_t> &amounts)
+{
+	for (size_t amount : amounts)
+	{
+		if (amount > 100000) continue; //every size is pushed and popped 100 times
+
+		report.add("storage", "Queue(RingBuffer)", "push_pop_x100", "sorted", amount, 1, amount * 200, queue_churn<Queue<int>>(amount));
+		report.add("storage", "Queue(NodePool list)", "push_pop_x100", "sorted", amount, 1, amount * 200,
+			queue_churn<Queue<int, DoublyLinkedList<int>>>(amount));
+		report.add("storage", "Queue(new/delete list)", "push_pop_x100", "sorted", amount, 1, amount * 200,
+			queue_churn<Queue<int, DoublyLinkedList<int, HeapAllocator>>>(amount));
+	}
+}
+
+void BenchmarkSerialization(BenchmarkReport &report, const std::vector<size_t> &amounts)
+{
+	const size_t containers = 16;
+	KeyDistribution distributions[] = { UNIFORM, SORTED };
+	for (KeyDistribution distribution : distributions)
+	{
+		const char *keysName = distribution_name(distribution);
+		for (size_t amount : amounts)
+		{
+			HeteroContainer<int> cont = hetero_with_containers(containers);
+			std::vector<int> keys = make_keys(distribution, amount);
+			cont.add_elements(keys.data(), keys.size());
+
+			HeteroContainer<int>::Format formats[] = { HeteroContainer<int>::TEXT, HeteroContainer<int>::BINARY };
+			for (HeteroContainer<int>::Format format : formats)
+			{
+				std::stringstream snapshot(std::ios::in | std::ios::out | std::ios::binary);
+				double save = measure_milliseconds([&cont, &snapshot, format]() { cont.save(snapshot, format); });
+
+				HeteroContainer<int> loaded;
+				double load = measure_milliseconds([&loaded, &snapshot, format]() { loaded.load(snapshot, format); });
+
+				bool text = format == HeteroContainer<int>::TEXT;
+				report.add("snapshot", "HeteroContainer", text ? "save_text" : "save_binary", keysName, amount, containers, amount, save);
+				report.add("snapshot", "HeteroContainer", text ? "load_text" : "load_binary", keysName, amount, containers, amount, load);
+			}
+
+			const char *fileName = "benchmark_snapshot.bin";
+			std::ofstream outFile(fileName, std::ios::binary);
+			cont.save(outFile, HeteroContainer<int>::BINARY);
+			outFile.close();
+
+			HeteroContainer<int> mapped;
+			double map = measure_milliseconds([&mapped, fileName]() { mapped.load_mapped(fileName); });
+			double firstQuery = measure_milliseconds([&mapped]() { benchmarkSink += mapped.contains(0); });
+			report.add("snapshot", "HeteroContainer", "load_mapped", keysName, amount, containers, amount, map);
+			report.add("snapshot", "HeteroContainer", "first_mapped_lookup", keysName, amount, containers, 1, firstQuery);
+
+			mapped = HeteroContainer<int>(); //unmaps the file before it is removed
+			std::remove(fileName);
+		}
+	}
+}
+
+void BenchmarkStaticDispatch(BenchmarkReport &report, size_t amount)
+{
+	const size_t containers = 16;
+	HeteroContainer<int> dynamic;
+	StaticHeteroContainer<int> fixed;
+	for (size_t ind = 0; ind < containers; ind++)
+	{
+		dynamic.add_container((HeteroContainer<int>::Type)(ind % 5));
+		fixed.add_container((HeteroContainer<int>::Type)(ind % 5));
+	}
+
+	std::vector<int> keys = make_keys(UNIFORM, amount);
+	for (int key : keys)
+	{
+		dynamic.add_element(key);
+		fixed.add_element(key);
+	}
+	dynamic.sort();
+	fixed.sort();
+
+	int missing = -1;
+	auto isMissing = [&missing](const int &number) { return number == missing; };
+	long long dynamicSum = 0, fixedSum = 0;
+	double dynamicScan = measure_milliseconds([&dynamic, &isMissing]() { benchmarkSink += dynamic.contains(PredicateRef<int>(isMissing)); });
+	double fixedScan = measure_milliseconds([&fixed, &isMissing]() { benchmarkSink += fixed.contains(isMissing); });
+	double dynamicMerge = measure_milliseconds([&dynamic, &dynamicSum]() { for (auto it = dynamic.begin(); it != dynamic.end(); ++it) dynamicSum += *it; });
+	double fixedMerge = measure_milliseconds([&fixed, &fixedSum]() { for (auto it = fixed.begin(); it != fixed.end(); ++it) fixedSum += *it; });
+	if (dynamicSum != fixedSum) std::cerr << "Sorted iteration MISMATCH between the virtual and the static container\n";
+
+	report.add("dispatch", "HeteroContainer", "predicate_scan", "uniform", amount, containers, amount, dynamicScan);
+	report.add("dispatch", "StaticHeteroContainer", "predicate_scan", "uniform", amount, containers, amount, fixedScan);
+	report.add("dispatch", "HeteroContainer", "sort_iterator", "uniform", amount, containers, amount, dynamicMerge);
+	report.add("dispatch", "StaticHeteroContainer", "sort_iterator", "uniform", amount, containers, amount, fixedMerge);
+}
+
+//sorted keys loaded as one batch give every subcontainer a disjoint range; lookups of present keys
+//with and without the zone maps
+void BenchmarkZoneMaps(BenchmarkReport &report, const std::vector<size_t> &amounts, const std::vector<size_t> &containerCounts)
+{
+	for (size_t amount : amounts)
+	{
+		std::vector<int> keys = make_keys(SORTED, amount);
+		for (size_t containers : containerCounts)
+		{
+			HeteroContainer<int> cont = hetero_with_containers(containers);
+			cont.use_zone_maps();
+			cont.add_elements(keys.data(), keys.size());
+			benchmarkSink += cont.contains(-1); //computes the zone maps
+
+			auto lookup = [&cont, &keys]()
+			{
+				for (size_t ind = 0; ind < BENCHMARK_LOOKUPS; ind++) benchmarkSink += cont.contains(keys[ind * 7919 % keys.size()]);
+			};
+			report.add("zone_maps", "HeteroContainer", "contains_partitioned", "sorted", amount, containers, BENCHMARK_LOOKUPS, measure_milliseconds(lookup));
+			cont.use_zone_maps(false);
+			report.add("zone_maps", "HeteroContainer", "contains_partitioned_unpruned", "sorted", amount, containers, BENCHMARK_LOOKUPS, measure_milliseconds(lookup));
+		}
+	}
+}
+
+//returns false when a result file cannot be written
+bool ExecuteBenchmarks(const BenchmarkOptions &options = BenchmarkOptions())
+{
+	std::vector<size_t> amounts = { 1000, 10000 };
+	std::vector<size_t> containerCounts = { 1, 8 };
+	if (!options.quick)
+	{
+		amounts.insert(amounts.end(), { 100000, 1000000 });
+		containerCounts = { 1, 4, 16, 64 };
+	}
+
+	BenchmarkReport report;
+	BenchmarkContainers(report, amounts);
+	BenchmarkHetero(report, amounts, containerCounts);
+	BenchmarkQueueChurn(report, amounts);
+	BenchmarkSerialization(report, amounts);
+	BenchmarkStaticDispatch(report, amounts.back());
+	BenchmarkZoneMaps(report, amounts, containerCounts);
+
+	bool written = true;
+	if (!options.csvFile.empty())
+	{
+		std::ofstream csv(options.csvFile);
+		report.write_csv(csv);
+		written = written && (bool)csv;
+	}
+	if (!options.jsonFile.empty())
+	{
+		std::ofstream json(options.jsonFile);
+		report.write_json(json);
+		written = written && (bool)json;
+	}
+
+	return written;
+}
@@ -1,41 +1,71 @@
 #pragma once
 
 #include "BaseContainer.h"
-#include "Stack.h"
+#include <assert.h>
 #include <algorithm>
 #include <vector>
 
+template <typename T>
+class BSTSortIterator;
+
 template <typename T>
 class BinSearchTree : public BaseContainer<T>
 {
 public:
+	template <typename M>
+	friend class BSTIterator;
+
 	template <typename M>
 	friend class BSTSortIterator;
 
 	template <typename M>
 	friend class BSTPreOrderIterator;
 
-	BinSearchTree();
+	BinSearchTree(bool selfBalancing = false); //self balancing trees keep AVL height after every insert and remove
 	BinSearchTree(const BinSearchTree&);
+	BinSearchTree(BinSearchTree&&) noexcept;
 	BinSearchTree<T>& operator= (BinSearchTree<T>);
 
 	virtual bool contains(const T&) const override;
-	virtual bool contains(Condition<T>) const override;
-	virtual void filter(Condition<T>) override;
-	virtual void sort() override; //TO DO
+	virtual bool contains(PredicateRef<T>) const override;
+	virtual void filter(PredicateRef<T>) override;
+	virtual void sort() override; //rebalances the tree in place
 
 	virtual void push(const T&) override;
+	virtual void push(T&&) override;
 	virtual T pop() override;
+	virtual void push_range(const T*, size_t) override; //a large batch is merged into the sorted tree and rebalanced
 
 	virtual size_t size() const override;
 	virtual short id() const override;
 	virtual bool empty() const override;
 	virtual BaseContainer<T>* clone() const override;
+	virtual MemoryUsage memory_usage() const override;
 
 	virtual BaseIterator<T>* begin(bool = true) const override;
 	virtual BaseIterator<T>* end() const override;
+	virtual BaseIterator<T>* lower_bound(const T&, size_t&) const override;
+	virtual BaseIterator<T>* upper_bound(const T&, size_t&) const override;
 
 	void remove(const T&);
+	template <typename... Args>
+	void emplace(Args&&...); //the element has to exist before its place is found, so it is built and moved in
+
+	//sorted iterators held by value, so their calls are resolved at compile time
+	typedef BSTSortIterator<T> Iterator;
+	Iterator cbegin() const;
+	Iterator cend() const;
+
+	//the same as the virtual overloads with the predicate inlined into the walk
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	void filter(Predicate);
+
+	//order statistics in O(height) - every node knows the size of its subtree
+	const T& select(size_t) const; //the element with the given zero based position in sorted order
+	size_t rank(const T&, bool inclusive = false) const; //the amount of elements smaller than (or equal to) the given one
+	size_t count_range(const T&, const T&) const; //the amount of elements in [from, to)
 
 	~BinSearchTree();
 
@@ -45,132 +75,204 @@ private:
 		Node *left;
 		T data;
 		Node * right;
+		Node *parent; //lets the iterators walk the tree without a stack
+		int height;
+		size_t size; //the amount of nodes in the subtree
 
-		Node(const T&, Node* = nullptr, Node* = nullptr);
+		template <typename Value>
+		Node(Value&&, Node* = nullptr, Node* = nullptr, Node* = nullptr);
 	};
 
 	bool contains(const T&, Node*) const;
-	bool contains(Condition<T>, Node*) const;
+	template <typename Predicate>
+	bool any_of(Predicate) const;
 	Node* find_min(Node *crr) const;
-	void remove(T, Node*&, bool); //we pass T by value because otherwise delete element changes during execution(because it referes tree node)
-	void insert(const T&, Node*&);
-	void filter(Condition<T>, Node*&);
+	static Node* successor(Node*); //the next node in order, found through the parent links
+	Node* bound(const T&, bool lower, size_t &skipped) const; //the first node not smaller (not lower - greater) than the element
+	void remove(const T&, Node*&); //removes every equal element; the element may be the data of a node of the tree
+	void unlink(Node*&); //deletes the node, its successor takes its place
+	void take_min(Node*&, T&); //moves the smallest element of the subtree out and unlinks its node
+	template <typename Value>
+	void insert(Value&&, Node*&, Node*);
 	void destroy_node(Node *);
-	void copy(Node*&, Node*);
-	void balance(Node*&, const std::vector<T>&, int, int);
+	void copy(Node*&, Node*, Node*);
+	template <typename Predicate>
+	void tree_to_vine(Predicate drop); //the nodes matching drop are deleted on the way
+	void vine_to_tree();
+	void compress(size_t);
+	void update_nodes(); //recomputes the heights and sizes of every node
+
+	int height(Node*) const;
+	size_t size(Node*) const;
+	void update_node(Node*); //recomputes the height and size of a node from its children
+	void rotate_left(Node*&);
+	void rotate_right(Node*&);
+	void restore(Node*&); //AVL rebalancing of a single node; does nothing for plain trees
 
 	Node *root;
 	size_t count;
+	bool selfBalancing;
 };
 
+//The position of a tree iterator is a single node and every traversal ends on nullptr,
+//so the sorted and the pre-order iterators compare with each other by one pointer
 template <typename T>
-class BSTSortIterator : public BaseIterator<T>
+class BSTIterator : public BaseIterator<T>
 {
 public:
-	BSTSortIterator(typename BinSearchTree<T>::Node*);
+	BSTIterator(typename BinSearchTree<T>::Node*);
 
-	virtual void next() override;
-	virtual T value() const override;
+	virtual const T& value() const override;
 	virtual bool are_equal(BaseIterator<T>*) const override;
-	virtual BaseIterator<T>* clone() const override;
 
-private:
-	void wind();
-	Stack<typename BinSearchTree<T>::Node*> nodeStack;
-	Stack<bool> shouldProcess;
+protected:
+	typename BinSearchTree<T>::Node *crr;
+};
+
+template <typename T>
+class BSTSortIterator : public BSTIterator<T>
+{
+public:
+	BSTSortIterator(typename BinSearchTree<T>::Node*, bool fromSmallest = true); //by default starts from the smallest element of the given tree
 
+	virtual void next() override;
+	virtual BaseIterator<T>* clone() const override;
 };
 
 template <typename T>
-class BSTPreOrderIterator : public BaseIterator<T>
+class BSTPreOrderIterator : public BSTIterator<T>
 {
 public:
 	BSTPreOrderIterator(typename BinSearchTree<T>::Node*);
 
 	virtual void next() override;
-	virtual T value() const override;
-	virtual bool are_equal(BaseIterator<T>*) const override;
 	virtual BaseIterator<T>* clone() const override;
-
-private:
-	void wind();
-	Stack<std::pair<typename BinSearchTree<T>::Node*, bool>> nodeStack;
 };
 
 template<typename T>
-inline BinSearchTree<T>::BinSearchTree()
-	: root(nullptr), count(0)
+inline BinSearchTree<T>::BinSearchTree(bool selfBalancing)
+	: root(nullptr), count(0), selfBalancing(selfBalancing)
 {}
 
 template<typename T>
 inline BinSearchTree<T>::BinSearchTree(const BinSearchTree &other)
-	: BinSearchTree()
+	: BinSearchTree(other.selfBalancing)
 {
-	copy(root, other.root);
+	copy(root, other.root, nullptr);
 	count = other.count;
 }
 
+template<typename T>
+inline BinSearchTree<T>::BinSearchTree(BinSearchTree &&other) noexcept
+	: BinSearchTree(other.selfBalancing)
+{
+	std::swap(root, other.root);
+	std::swap(count, other.count);
+}
+
 template<typename T>
 inline BinSearchTree<T> & BinSearchTree<T>::operator=(BinSearchTree<T> other)
 {
 	std::swap(root, other.root);
 	std::swap(count, other.count);
+	std::swap(selfBalancing, other.selfBalancing);
+
+	return *this;
 }
 
 template<typename T>
 inline bool BinSearchTree<T>::contains(const T &element) const
 {
+	HETERO_OPERATION(containsProbes);
 	return contains(element, root);
 }
 
 template<typename T>
-inline bool BinSearchTree<T>::contains(Condition<T> pred) const
+inline bool BinSearchTree<T>::contains(PredicateRef<T> pred) const
+{
+	HETERO_OPERATION(containsProbes);
+	return any_of(pred);
+}
+
+template<typename T>
+inline void BinSearchTree<T>::filter(PredicateRef<T> pred)
+{
+	HETERO_SCOPE();
+	//the matching nodes are dropped while the tree is flattened, then the survivors are rebalanced
+	tree_to_vine([&pred](const T &crr) { HETERO_COUNT(predicateEvaluations); return pred(crr); });
+	vine_to_tree();
+}
+
+template<typename T>
+template<typename Predicate, typename>
+inline bool BinSearchTree<T>::contains(Predicate pred) const
 {
-	return contains(pred, root);
+	HETERO_OPERATION(containsProbes);
+	return any_of(pred);
 }
 
 template<typename T>
-inline void BinSearchTree<T>::filter(Condition<T> pred)
+template<typename Predicate, typename>
+inline void BinSearchTree<T>::filter(Predicate pred)
 {
-	filter(pred, root);
+	HETERO_SCOPE();
+	tree_to_vine([&pred](const T &crr) { HETERO_COUNT(predicateEvaluations); return pred(crr); });
+	vine_to_tree();
 }
 
 template<typename T>
 inline void BinSearchTree<T>::sort()
 {
-	std::vector<int> elements;
-	BaseIterator<T> *it = begin();
-	BaseIterator<T> *end = this->end();
-	while (!it->are_equal(end))
+	HETERO_SCOPE();
+	//Day-Stout-Warren: the nodes are rotated into a sorted vine and then folded back into a complete tree;
+	//no node is allocated or copied and the extra memory is constant
+	tree_to_vine([](const T&) { return false; });
+	vine_to_tree();
+}
+
+template<typename T>
+inline void BinSearchTree<T>::vine_to_tree()
+{
+	size_t full = 1;
+	while (full * 2 <= count + 1) full *= 2;
+	--full; //the nodes of the largest perfect tree that fits
+
+	compress(count - full);
+	while (full > 1)
 	{
-		elements.push_back(it->value());
-		it->next();
+		full /= 2;
+		compress(full);
 	}
 
-	delete it; delete end;
-	destroy_node(root);
-	root = nullptr;
-	balance(root, elements, 0, elements.size() - 1);
+	update_nodes();
 }
 
 template<typename T>
 inline bool BinSearchTree<T>::contains(const T &element, Node *crr) const
 {
-	if (crr == nullptr) return false;
-	if (element == crr->data) return true;
+	while (crr != nullptr)
+	{
+		HETERO_COUNT(comparisons);
+		if (element == crr->data) return true;
 
-	if (crr->data > element) return contains(element, crr->left);
+		HETERO_COUNT(comparisons);
+		crr = crr->data > element ? crr->left : crr->right;
+	}
 
-	return contains(element, crr->right);
+	return false;
 }
 
 template<typename T>
-inline bool BinSearchTree<T>::contains(Condition<T> pred, Node *crr) const
+template<typename Predicate>
+inline bool BinSearchTree<T>::any_of(Predicate pred) const
 {
-	if (crr == nullptr) return false;
-	
-	return pred(crr->data) ||
-		contains(pred, crr->left) || contains(pred, crr->right);
+	for (Node *crr = find_min(root); crr != nullptr; crr = successor(crr))
+	{
+		HETERO_COUNT(predicateEvaluations);
+		if (pred(crr->data)) return true;
+	}
+
+	return false;
 }
 
 template<typename T>
@@ -182,71 +284,112 @@ inline typename BinSearchTree<T>::Node * BinSearchTree<T>::find_min(Node * crr)
 }
 
 template<typename T>
-inline void BinSearchTree<T>::remove(T element, Node *&crr, bool removeEqual)
+inline typename BinSearchTree<T>::Node * BinSearchTree<T>::successor(Node *crr)
 {
-	if (crr == nullptr) return;
-	
-	if (crr->data == element && crr->left == nullptr)
+	if (crr->right != nullptr)
 	{
-		Node *save = crr;
+		//the smallest element of the right subtree
 		crr = crr->right;
-		delete save; --count;
+		while (crr->left != nullptr) crr = crr->left;
 
-		if (removeEqual) remove(element, crr, true);
-		return;
+		return crr;
 	}
 
-	if (crr->data == element && crr->right == nullptr)
-	{
-		Node *save = crr;
-		crr = crr->left;
-		delete save; --count;
+	//the first ancestor whose left subtree we are leaving
+	while (crr->parent != nullptr && crr->parent->right == crr) crr = crr->parent;
 
-		if (removeEqual) remove(element, crr, true);
-		return;
+	return crr->parent;
+}
+
+template<typename T>
+inline typename BinSearchTree<T>::Node * BinSearchTree<T>::bound(const T &element, bool lower, size_t &skipped) const
+{
+	//the left subtree and the node itself are skipped whenever the search turns right
+	Node *result = nullptr;
+	Node *crr = root;
+	skipped = 0;
+	while (crr != nullptr)
+	{
+		HETERO_COUNT(comparisons);
+		if (lower ? crr->data < element : !(element < crr->data))
+		{
+			skipped += size(crr->left) + 1;
+			crr = crr->right;
+		}
+		else
+		{
+			result = crr;
+			crr = crr->left;
+		}
 	}
 
+	return result;
+}
+
+template<typename T>
+inline void BinSearchTree<T>::remove(const T &element, Node *&crr)
+{
+	if (crr == nullptr) return;
+
 	if (crr->data == element)
 	{
-		Node *rightMin = find_min(crr->right);
-		crr->data = rightMin->data;
-		remove(rightMin->data, crr->right, false);
-
-		if (removeEqual) remove(element, crr, true); //if there are more than one same elements
+		//the equal elements below go first, while the element may still refer to the data of this node
+		remove(element, crr->left);
+		remove(element, crr->right);
+		unlink(crr);
 		return;
 	}
 
-	element < crr->data ? remove(element, crr->left, removeEqual) : remove(element, crr->right, removeEqual);
+	element < crr->data ? remove(element, crr->left) : remove(element, crr->right);
+	restore(crr);
 }
 
 template<typename T>
-inline void BinSearchTree<T>::insert(const T &element, Node *&crr)
+inline void BinSearchTree<T>::unlink(Node *&crr)
 {
-	if (crr == nullptr)
+	if (crr->left != nullptr && crr->right != nullptr)
 	{
-		crr = new Node(element);
-		++count;
+		take_min(crr->right, crr->data);
+		restore(crr);
 		return;
 	}
 
-	element < crr->data ? insert(element, crr->left) : insert(element, crr->right);
+	Node *save = crr;
+	crr = crr->left != nullptr ? crr->left : crr->right;
+	if (crr != nullptr) crr->parent = save->parent;
+	delete save; --count;
 }
 
 template<typename T>
-inline void BinSearchTree<T>::filter(Condition<T> pred, Node *&crr)
+inline void BinSearchTree<T>::take_min(Node *&crr, T &destination)
 {
-	if (crr == nullptr) return;
-
-	if (pred(crr->data))
+	if (crr->left != nullptr)
 	{
-		remove(crr->data, crr, true);
-		filter(pred, crr);
+		take_min(crr->left, destination);
+		restore(crr);
+		return;
+	}
+
+	destination = std::move(crr->data);
+	unlink(crr);
+}
 
+template<typename T>
+template<typename Value>
+inline void BinSearchTree<T>::insert(Value &&element, Node *&crr, Node *parent)
+{
+	if (crr == nullptr)
+	{
+		HETERO_COUNT(nodeAllocations);
+		crr = new Node(std::forward<Value>(element), nullptr, nullptr, parent);
+		++count;
 		return;
 	}
 
-	filter(pred, crr->left);
-	filter(pred, crr->right);
+	//only the call that creates the node uses up the element
+	HETERO_COUNT(comparisons);
+	element < crr->data ? insert(std::forward<Value>(element), crr->left, crr) : insert(std::forward<Value>(element), crr->right, crr);
+	restore(crr);
 }
 
 template<typename T>
@@ -261,38 +404,220 @@ inline void BinSearchTree<T>::destroy_node(Node *crr)
 }
 
 template<typename T>
-inline void BinSearchTree<T>::copy(Node *&thisCrr, Node *otherCrr)
+inline void BinSearchTree<T>::copy(Node *&thisCrr, Node *otherCrr, Node *parent)
 {
 	if (otherCrr == nullptr) return;
 
-	thisCrr = new Node(otherCrr->data);
-	copy(thisCrr->left, otherCrr->left);
-	copy(thisCrr->right, otherCrr->right);
+	thisCrr = new Node(otherCrr->data, nullptr, nullptr, parent);
+	thisCrr->height = otherCrr->height;
+	thisCrr->size = otherCrr->size;
+	copy(thisCrr->left, otherCrr->left, thisCrr);
+	copy(thisCrr->right, otherCrr->right, thisCrr);
 }
 
 template<typename T>
-inline void BinSearchTree<T>::balance(Node *&crr, const std::vector<T> &elements, int start, int end)
+template<typename Predicate>
+inline void BinSearchTree<T>::tree_to_vine(Predicate drop)
 {
-	if (start > end) return;
+	//rotates every left child up until the tree is a chain of right children; a node without a left
+	//child is the next one in order, so it is either kept in the vine or dropped right away
+	Node **link = &root;
+	Node *parent = nullptr;
+	while (*link != nullptr)
+	{
+		Node *crr = *link;
+		if (crr->left != nullptr)
+		{
+			rotate_right(*link);
+		}
+		else if (drop(crr->data))
+		{
+			*link = crr->right;
+			if (crr->right != nullptr) crr->right->parent = parent;
+			delete crr; --count;
+		}
+		else
+		{
+			parent = crr;
+			link = &crr->right;
+		}
+	}
+}
 
-	int middle = (start + end) / 2;
-	crr = new Node(elements[middle]);
+template<typename T>
+inline void BinSearchTree<T>::compress(size_t rotations)
+{
+	//every second node of the vine goes down as the left child of its successor
+	Node **link = &root;
+	for (size_t ind = 0; ind < rotations; ind++)
+	{
+		rotate_left(*link);
+		link = &(*link)->right;
+	}
+}
 
-	balance(crr->left, elements, start, middle - 1);
-	balance(crr->right, elements, middle + 1, end);
+template<typename T>
+inline void BinSearchTree<T>::update_nodes()
+{
+	//post-order walk over the parent links, so it needs neither recursion nor a stack
+	Node *previous = nullptr;
+	Node *crr = root;
+	while (crr != nullptr)
+	{
+		Node *next;
+		if (previous == crr->parent) next = crr->left != nullptr ? crr->left : crr->right != nullptr ? crr->right : crr->parent;
+		else if (previous == crr->left && crr->right != nullptr) next = crr->right;
+		else next = crr->parent;
+
+		if (next == crr->parent) update_node(crr);
+		previous = crr;
+		crr = next;
+	}
+}
+
+template<typename T>
+inline int BinSearchTree<T>::height(Node *crr) const
+{
+	return crr == nullptr ? 0 : crr->height;
+}
+
+template<typename T>
+inline size_t BinSearchTree<T>::size(Node *crr) const
+{
+	return crr == nullptr ? 0 : crr->size;
+}
+
+template<typename T>
+inline void BinSearchTree<T>::update_node(Node *crr)
+{
+	crr->height = std::max(height(crr->left), height(crr->right)) + 1;
+	crr->size = size(crr->left) + size(crr->right) + 1;
+}
+
+template<typename T>
+inline void BinSearchTree<T>::rotate_left(Node *&crr)
+{
+	Node *pivot = crr->right;
+	crr->right = pivot->left;
+	pivot->left = crr;
+
+	if (crr->right != nullptr) crr->right->parent = crr;
+	pivot->parent = crr->parent;
+	crr->parent = pivot;
+
+	update_node(crr);
+	update_node(pivot);
+	crr = pivot;
+}
+
+template<typename T>
+inline void BinSearchTree<T>::rotate_right(Node *&crr)
+{
+	Node *pivot = crr->left;
+	crr->left = pivot->right;
+	pivot->right = crr;
+
+	if (crr->left != nullptr) crr->left->parent = crr;
+	pivot->parent = crr->parent;
+	crr->parent = pivot;
+
+	update_node(crr);
+	update_node(pivot);
+	crr = pivot;
+}
+
+template<typename T>
+inline void BinSearchTree<T>::restore(Node *&crr)
+{
+	if (crr == nullptr) return;
+
+	update_node(crr);
+	if (!selfBalancing) return;
+
+	int difference = height(crr->left) - height(crr->right);
+	if (difference > 1)
+	{
+		if (height(crr->left->left) < height(crr->left->right)) rotate_left(crr->left);
+		rotate_right(crr);
+	}
+	else if (difference < -1)
+	{
+		if (height(crr->right->right) < height(crr->right->left)) rotate_right(crr->right);
+		rotate_left(crr);
+	}
 }
 
 template<typename T>
 inline void BinSearchTree<T>::push(const T &element)
 {
-	insert(element, root);
+	HETERO_OPERATION(pushes);
+	insert(element, root, nullptr);
+}
+
+template<typename T>
+inline void BinSearchTree<T>::push(T &&element)
+{
+	HETERO_OPERATION(pushes);
+	insert(std::move(element), root, nullptr);
+}
+
+template<typename T>
+template<typename... Args>
+inline void BinSearchTree<T>::emplace(Args&&... args)
+{
+	HETERO_OPERATION(pushes);
+	insert(T(std::forward<Args>(args)...), root, nullptr);
+}
+
+template<typename T>
+inline void BinSearchTree<T>::push_range(const T *first, size_t amount)
+{
+	HETERO_OPERATION_N(pushes, amount);
+
+	//a batch that is small compared to the tree is cheaper to insert one by one
+	if (amount * (height(root) + 1) < count)
+	{
+		for (size_t ind = 0; ind < amount; ind++) insert(first[ind], root, nullptr);
+		return;
+	}
+
+	std::vector<T> batch(first, first + amount);
+	std::stable_sort(batch.begin(), batch.end(), [](const T &left, const T &right) { HETERO_COUNT(comparisons); return left < right; });
+
+	//the new nodes are merged into the vine of the tree (after the equal old ones, like insert does)
+	//and the vine is folded back into a complete tree
+	tree_to_vine([](const T&) { return false; });
+	Node **link = &root;
+	Node *parent = nullptr;
+	for (T &element : batch)
+	{
+		while (*link != nullptr)
+		{
+			HETERO_COUNT(comparisons);
+			if (element < (*link)->data) break;
+
+			parent = *link;
+			link = &parent->right;
+		}
+
+		HETERO_COUNT(nodeAllocations);
+		Node *node = new Node(std::move(element), nullptr, *link, parent);
+		if (*link != nullptr) (*link)->parent = node;
+		*link = node;
+		++count;
+
+		parent = node;
+		link = &node->right;
+	}
+	vine_to_tree();
 }
 
 template<typename T>
 inline T BinSearchTree<T>::pop()
 {
-	T save = root->data;
-	remove(root->data, root, false);
+	HETERO_OPERATION(pops);
+	T save = std::move(root->data);
+	unlink(root);
 
 	return save;
 }
@@ -306,7 +631,7 @@ inline size_t BinSearchTree<T>::size() const
 template<typename T>
 inline short BinSearchTree<T>::id() const
 {
-	return 3;
+	return selfBalancing ? 4 : 3;
 }
 
 template<typename T>
@@ -321,6 +646,16 @@ inline BaseContainer<T>* BinSearchTree<T>::clone() const
 	return new BinSearchTree<T>(*this);
 }
 
+template<typename T>
+inline MemoryUsage BinSearchTree<T>::memory_usage() const
+{
+	MemoryUsage usage;
+	usage.payload = count * sizeof(T);
+	usage.overhead = count * (sizeof(Node) - sizeof(T)) + sizeof(*this);
+
+	return usage;
+}
+
 template<typename T>
 inline BaseIterator<T>* BinSearchTree<T>::begin(bool useSortIterator) const
 {
@@ -339,126 +674,155 @@ inline BaseIterator<T>* BinSearchTree<T>::end() const
 }
 
 template<typename T>
-inline BinSearchTree<T>::Node::Node(const T &data, Node *left, Node *right)
-	: data(data), left(left), right(right)
+inline typename BinSearchTree<T>::Iterator BinSearchTree<T>::cbegin() const
 {
+	return Iterator(root);
 }
 
 template<typename T>
-inline void BinSearchTree<T>::remove(const T &element)
+inline typename BinSearchTree<T>::Iterator BinSearchTree<T>::cend() const
 {
-	remove(element, root, true);
+	return Iterator(nullptr);
 }
 
 template<typename T>
-inline BinSearchTree<T>::~BinSearchTree()
+inline BaseIterator<T>* BinSearchTree<T>::lower_bound(const T &element, size_t &skipped) const
 {
-	destroy_node(root);
+	HETERO_SCOPE();
+	return new BSTSortIterator<T>(bound(element, true, skipped), false);
 }
 
 template<typename T>
-inline BSTSortIterator<T>::BSTSortIterator(typename BinSearchTree<T>::Node *root)
+inline BaseIterator<T>* BinSearchTree<T>::upper_bound(const T &element, size_t &skipped) const
 {
-	if (root == nullptr) return;
-	
-	nodeStack.push(root);
-	shouldProcess.push(false);
-	wind();
+	HETERO_SCOPE();
+	return new BSTSortIterator<T>(bound(element, false, skipped), false);
 }
 
 template<typename T>
-inline void BSTSortIterator<T>::next()
+template<typename Value>
+inline BinSearchTree<T>::Node::Node(Value &&data, Node *left, Node *right, Node *parent)
+	: left(left), data(std::forward<Value>(data)), right(right), parent(parent), height(1), size(1)
 {
-	nodeStack.pop();
-	shouldProcess.pop();
-	wind();
 }
 
 template<typename T>
-inline T BSTSortIterator<T>::value() const
+inline void BinSearchTree<T>::remove(const T &element)
 {
-	return nodeStack.top()->data;
+	remove(element, root);
 }
 
 template<typename T>
-inline bool BSTSortIterator<T>::are_equal(BaseIterator<T> *other) const
+inline const T & BinSearchTree<T>::select(size_t position) const
 {
-	return nodeStack == ((BSTSortIterator<T>*)other)->nodeStack && shouldProcess == ((BSTSortIterator<T>*)other)->shouldProcess;
+	assert(position < count);
+
+	Node *crr = root;
+	while (position != size(crr->left))
+	{
+		if (position < size(crr->left))
+		{
+			crr = crr->left;
+		}
+		else
+		{
+			position -= size(crr->left) + 1;
+			crr = crr->right;
+		}
+	}
+
+	return crr->data;
 }
 
 template<typename T>
-inline BaseIterator<T>* BSTSortIterator<T>::clone() const
+inline size_t BinSearchTree<T>::rank(const T &element, bool inclusive) const
 {
-	return new BSTSortIterator<T>(*this);
+	size_t result;
+	bound(element, !inclusive, result);
+
+	return result;
 }
 
 template<typename T>
-inline void BSTSortIterator<T>::wind()
+inline size_t BinSearchTree<T>::count_range(const T &from, const T &to) const
 {
-	while (!nodeStack.empty() && shouldProcess.top() != true)
-	{
-		typename BinSearchTree<T>::Node* crr = nodeStack.pop();
-		bool isReady = shouldProcess.pop();
+	if (!(from < to)) return 0;
 
-		if (crr->right != nullptr)
-		{
-			nodeStack.push(crr->right);
-			shouldProcess.push(false);
-		}
-		nodeStack.push(crr);
-		shouldProcess.push(true);
-			
-		if (crr->left != nullptr)
-		{
-			nodeStack.push(crr->left);
-			shouldProcess.push(false);
-		}
-	}
+	return rank(to) - rank(from);
 }
 
 template<typename T>
-inline BSTPreOrderIterator<T>::BSTPreOrderIterator(typename BinSearchTree<T>::Node *root)
+inline BinSearchTree<T>::~BinSearchTree()
 {
-	if (root == nullptr) return;
-	
-	nodeStack.push(std::make_pair(root, false));
-	wind();
+	destroy_node(root);
 }
 
 template<typename T>
-inline void BSTPreOrderIterator<T>::next()
+inline BSTIterator<T>::BSTIterator(typename BinSearchTree<T>::Node *crr)
+	: crr(crr)
+{}
+
+template<typename T>
+inline const T& BSTIterator<T>::value() const
 {
-	nodeStack.pop();
-	wind();
+	return crr->data;
 }
 
 template<typename T>
-inline T BSTPreOrderIterator<T>::value() const
+inline bool BSTIterator<T>::are_equal(BaseIterator<T> *other) const
 {
-	return nodeStack.top().first->data;
+	return crr == ((BSTIterator<T>*)other)->crr;
 }
 
 template<typename T>
-inline bool BSTPreOrderIterator<T>::are_equal(BaseIterator<T> *other) const
+inline BSTSortIterator<T>::BSTSortIterator(typename BinSearchTree<T>::Node *root, bool fromSmallest)
+	: BSTIterator<T>(root)
 {
-	return nodeStack == ((BSTPreOrderIterator<T>*)other)->nodeStack;
+	if (this->crr == nullptr || !fromSmallest) return;
+
+	while (this->crr->left != nullptr) this->crr = this->crr->left;
 }
 
 template<typename T>
-inline BaseIterator<T>* BSTPreOrderIterator<T>::clone() const
+inline void BSTSortIterator<T>::next()
 {
-	return new BSTPreOrderIterator<T>(*this);
+	this->crr = BinSearchTree<T>::successor(this->crr);
 }
 
 template<typename T>
-inline void BSTPreOrderIterator<T>::wind()
+inline BaseIterator<T>* BSTSortIterator<T>::clone() const
 {
-	while (!nodeStack.empty() && nodeStack.top().second == false)
+	return new BSTSortIterator<T>(*this);
+}
+
+template<typename T>
+inline BSTPreOrderIterator<T>::BSTPreOrderIterator(typename BinSearchTree<T>::Node *root)
+	: BSTIterator<T>(root)
+{}
+
+template<typename T>
+inline void BSTPreOrderIterator<T>::next()
+{
+	typename BinSearchTree<T>::Node *crr = this->crr;
+	if (crr->left != nullptr)
 	{
-		typename BinSearchTree<T>::Node *crr = nodeStack.pop().first;
-		
-		if (crr->right != nullptr) nodeStack.push(std::make_pair(crr->right, false));
-		if (crr->left != nullptr) nodeStack.push(std::make_pair(crr->left, false));
-		nodeStack.push(std::make_pair(crr, true));
+		this->crr = crr->left;
+		return;
 	}
+
+	if (crr->right != nullptr)
+	{
+		this->crr = crr->right;
+		return;
+	}
+
+	//climb up to the first ancestor with a right subtree that is not visited yet
+	while (crr->parent != nullptr && (crr->parent->right == crr || crr->parent->right == nullptr)) crr = crr->parent;
+	this->crr = crr->parent == nullptr ? nullptr : crr->parent->right;
+}
+
+template<typename T>
+inline BaseIterator<T>* BSTPreOrderIterator<T>::clone() const
+{
+	return new BSTPreOrderIterator<T>(*this);
 }
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//Binary snapshot layout of a HeteroContainer; every integer is little endian:
+//	header   - magic "HCNT", u16 version, u16 flags, u32 element size, u32 reserved, u64 containers count
+//	entries  - u32 type, u32 reserved, u64 elements count, u64 payload byte length; one per subcontainer
+//	payloads - the elements of every subcontainer in serialization order, each payload padded to 8 bytes;
+//	           trees are written in ascending order, so a mapped tree is searched without rebuilding it
+//	footer   - u64 FNV-1a checksum of everything before it
+//With the RAW_PAYLOAD flag an element is stored as its sizeof(T) bytes, otherwise as a u32 byte length
+//followed by its text form (the raw bytes for std::string).
+namespace BinaryFormat
+{
+	const char MAGIC[4] = { 'H', 'C', 'N', 'T' };
+	const uint16_t VERSION = 2; //1 wrote the trees in pre-order
+	const uint16_t RAW_PAYLOAD = 1;
+	const size_t HEADER_SIZE = 24;
+	const size_t ENTRY_SIZE = 24;
+	const size_t ALIGNMENT = 8;
+
+	inline bool little_endian_host()
+	{
+		const uint16_t probe = 1;
+		return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+	}
+
+	inline size_t padding(size_t length)
+	{
+		return (ALIGNMENT - length % ALIGNMENT) % ALIGNMENT;
+	}
+
+	inline void append(std::string &out, uint64_t value, size_t bytes)
+	{
+		for (size_t ind = 0; ind < bytes; ind++) out.push_back((char)((value >> (8 * ind)) & 0xFF));
+	}
+
+	inline uint64_t extract(const char *data, size_t bytes)
+	{
+		uint64_t value = 0;
+		for (size_t ind = 0; ind < bytes; ind++) value |= (uint64_t)(unsigned char)data[ind] << (8 * ind);
+
+		return value;
+	}
+
+	//u32 length followed by the bytes themselves
+	inline void append_bytes(std::string &out, const std::string &bytes)
+	{
+		append(out, bytes.size(), 4);
+		out += bytes;
+	}
+
+	inline const char* extract_bytes(const char *crr, const char *end, std::string &bytes)
+	{
+		if (end - crr < 4) return nullptr;
+
+		size_t length = (size_t)extract(crr, 4);
+		crr += 4;
+		if ((size_t)(end - crr) < length) return nullptr;
+
+		bytes.assign(crr, length);
+
+		return crr + length;
+	}
+
+	//FNV-1a over every byte written or read
+	class Checksum
+	{
+	public:
+		Checksum() : hash(14695981039346656037ULL) {}
+
+		void update(const char *data, size_t length)
+		{
+			for (size_t ind = 0; ind < length; ind++)
+			{
+				hash ^= (unsigned char)data[ind];
+				hash *= 1099511628211ULL;
+			}
+		}
+
+		uint64_t value() const { return hash; }
+
+	private:
+		uint64_t hash;
+	};
+
+	//Element encoding - trivially copyable types are copied byte by byte
+	template <typename T, bool = std::is_trivially_copyable<T>::value>
+	struct Codec
+	{
+		static const bool raw = true;
+
+		static void encode(const T &element, std::string &out)
+		{
+			char bytes[sizeof(T)];
+			memcpy(bytes, &element, sizeof(T));
+			if (std::is_arithmetic<T>::value && !little_endian_host()) std::reverse(bytes, bytes + sizeof(T));
+
+			out.append(bytes, sizeof(T));
+		}
+
+		static const char* decode(const char *crr, const char *end, T &element)
+		{
+			if ((size_t)(end - crr) < sizeof(T)) return nullptr;
+
+			char bytes[sizeof(T)];
+			memcpy(bytes, crr, sizeof(T));
+			if (std::is_arithmetic<T>::value && !little_endian_host()) std::reverse(bytes, bytes + sizeof(T));
+			memcpy(&element, bytes, sizeof(T));
+
+			return crr + sizeof(T);
+		}
+	};
+
+	//everything else goes through its stream operators
+	template <typename T>
+	struct Codec<T, false>
+	{
+		static const bool raw = false;
+
+		static void encode(const T &element, std::string &out)
+		{
+			std::ostringstream text;
+			text << element;
+			append_bytes(out, text.str());
+		}
+
+		static const char* decode(const char *crr, const char *end, T &element)
+		{
+			std::string bytes;
+			crr = extract_bytes(crr, end, bytes);
+			if (crr == nullptr) return nullptr;
+
+			std::istringstream text(bytes);
+			text >> element;
+
+			return text.fail() ? nullptr : crr;
+		}
+	};
+
+	template <>
+	struct Codec<std::string, false>
+	{
+		static const bool raw = false;
+
+		static void encode(const std::string &element, std::string &out)
+		{
+			append_bytes(out, element);
+		}
+
+		static const char* decode(const char *crr, const char *end, std::string &element)
+		{
+			return extract_bytes(crr, end, element);
+		}
+	};
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//Split block Bloom filter. An element sets one bit in each of the eight 32 bit words of a single 256 bit
+//block chosen by its hash, so an insert or a probe touches one cache line. Sized for 10 bits per element
+//it answers about 1% of the probes for missing elements with a false "may contain".
+class BloomFilter
+{
+public:
+	BloomFilter();
+
+	void reset(size_t expected); //an empty filter sized for the expected amount of elements
+	void insert(uint64_t hash);
+	bool may_contain(uint64_t hash) const;
+	bool full() const; //holds as many elements as it was sized for - more would raise the false positives
+	size_t memory() const; //bytes of the blocks
+
+private:
+	struct Block
+	{
+		uint32_t words[8];
+	};
+
+	static const size_t BITS_PER_ELEMENT = 10;
+
+	size_t block_of(uint64_t) const;
+	static uint32_t mask_of(uint64_t, size_t);
+
+	std::vector<Block> blocks;
+	size_t inserted;
+	size_t capacity;
+};
+
+//The hash a membership filter uses for an element - std::hash<T> mixed into 64 bits. Types without
+//std::hash have no filters unless MembershipHash is specialized for them.
+template <typename T, typename = void>
+struct MembershipHash
+{
+	static const bool available = false;
+
+	static uint64_t of(const T&)
+	{
+		return 0;
+	}
+};
+
+template <typename T>
+struct MembershipHash<T, decltype((void)std::hash<T>()(std::declval<const T&>()))>
+{
+	static const bool available = true;
+
+	static uint64_t of(const T &element)
+	{
+		//the splitmix64 finalizer - std::hash of an integer is often the integer itself
+		uint64_t hash = (uint64_t)std::hash<T>()(element);
+		hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+
+		return hash ^ (hash >> 31);
+	}
+};
+
+inline BloomFilter::BloomFilter()
+	: inserted(0), capacity(0)
+{}
+
+inline void BloomFilter::reset(size_t expected)
+{
+	size_t blocksCount = (expected * BITS_PER_ELEMENT + 255) / 256;
+	blocks.assign(blocksCount == 0 ? 1 : blocksCount, Block());
+	inserted = 0;
+	capacity = blocks.size() * 256 / BITS_PER_ELEMENT;
+}
+
+inline void BloomFilter::insert(uint64_t hash)
+{
+	Block &block = blocks[block_of(hash)];
+	for (size_t ind = 0; ind < 8; ind++) block.words[ind] |= mask_of(hash, ind);
+	++inserted;
+}
+
+inline bool BloomFilter::may_contain(uint64_t hash) const
+{
+	const Block &block = blocks[block_of(hash)];
+	for (size_t ind = 0; ind < 8; ind++)
+	{
+		if ((block.words[ind] & mask_of(hash, ind)) == 0) return false;
+	}
+
+	return true;
+}
+
+inline bool BloomFilter::full() const
+{
+	return inserted >= capacity;
+}
+
+inline size_t BloomFilter::memory() const
+{
+	return blocks.capacity() * sizeof(Block);
+}
+
+inline size_t BloomFilter::block_of(uint64_t hash) const
+{
+	//the high half of the hash scaled to the amount of blocks, without a division
+	return (size_t)(((hash >> 32) * blocks.size()) >> 32);
+}
+
+inline uint32_t BloomFilter::mask_of(uint64_t hash, size_t word)
+{
+	static const uint32_t SALT[8] = { 0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+		0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+
+	return uint32_t(1) << (((uint32_t)hash * SALT[word]) >> 27);
+}
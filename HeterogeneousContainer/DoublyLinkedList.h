@@ -1,40 +1,66 @@
 #pragma once
 
 #include "BaseContainer.h"
+#include "NodePool.h"
 #include <assert.h>
 #include <algorithm>
+#include <type_traits>
 
+template <typename T, template <typename> class Allocator>
+class ListIterator;
 
-template <typename T>
+//Allocator is the node allocator of the list - see NodePool.h for the interface
+template <typename T, template <typename> class Allocator = NodePool>
 class DoublyLinkedList : public BaseContainer<T>
 {
 public:
-	template <typename M>
+	template <typename M, template <typename> class A>
 	friend class ListIterator;
 
 	DoublyLinkedList();
-	DoublyLinkedList(const DoublyLinkedList<T>&);
-	DoublyLinkedList<T>& operator=(DoublyLinkedList<T>);
+	DoublyLinkedList(const DoublyLinkedList<T, Allocator>&);
+	DoublyLinkedList(DoublyLinkedList<T, Allocator>&&) noexcept;
+	DoublyLinkedList<T, Allocator>& operator=(DoublyLinkedList<T, Allocator>);
 
 	virtual bool contains(const T&) const override;
-	virtual bool contains(Condition<T>) const;
-	virtual void filter(Condition<T>);
+	virtual bool contains(PredicateRef<T>) const override;
+	virtual void filter(PredicateRef<T>) override;
 	virtual void sort();
 	virtual void push(const T&) override; //push front
+	virtual void push(T&&) override;
 	virtual T pop() override; //pop front
 	virtual size_t size() const override;
 	virtual short id() const override;
 	virtual bool empty() const override;
 	virtual BaseContainer<T>* clone() const override;
+	virtual MemoryUsage memory_usage() const override;
+	MemoryUsage heap_usage() const; //the nodes only - for the owners that hold the list by value
 
 	virtual BaseIterator<T>* begin(bool = true) const override;
 	virtual BaseIterator<T>* end() const override;
 
+	//iterators held by value, so their calls are resolved at compile time
+	typedef ListIterator<T, Allocator> Iterator;
+	Iterator cbegin() const;
+	Iterator cend() const;
+
 	void push_back(const T&);
+	void push_back(T&&);
 	T pop_back();
+	template <typename... Args>
+	void emplace(Args&&...); //builds the element in place at the front
+	template <typename... Args>
+	void emplace_back(Args&&...);
 	const T& peek_front() const;
 	const T& peek_back() const;
-	bool operator==(const DoublyLinkedList<T>&) const;
+	bool operator==(const DoublyLinkedList<T, Allocator>&) const;
+	void clear();
+
+	//the same as the virtual overloads with the predicate inlined into the scan
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	void filter(Predicate);
 
 	virtual ~DoublyLinkedList() override;
 
@@ -45,44 +71,55 @@ private:
 		T data;
 		Node *next;
 
-		Node(Node*, const T&, Node*);
+		template <typename... Args>
+		Node(Node*, Node*, Args&&...);
 	};
 
-	void DeleteNodeAndChildren(Node*);
+	template <typename... Args>
+	Node* create_node(Node*, Node*, Args&&...);
+	void destroy_node(Node*);
+	Node* merge(Node*, Node*) const;
+
+	template <typename Predicate>
+	bool any_of(Predicate) const;
+	template <typename Predicate>
+	void remove_if(Predicate);
 
 	Node *first;
 	Node *last;
 	size_t count;
+	Allocator<Node> nodes;
 };
 
-template <typename T>
+template <typename T, template <typename> class Allocator>
 class ListIterator : public BaseIterator<T>
 {
 public:
-	ListIterator(typename DoublyLinkedList<T>::Node*);
+	ListIterator(typename DoublyLinkedList<T, Allocator>::Node*);
 
 	virtual void next() override;
-	virtual T value() const override;
+	virtual const T& value() const override;
 	virtual bool are_equal(BaseIterator<T>*) const override;
 	virtual BaseIterator<T>* clone() const override;
 
 private:
-	typename DoublyLinkedList<T>::Node *crr;
+	typename DoublyLinkedList<T, Allocator>::Node *crr;
 };
 
-template<typename T>
-inline DoublyLinkedList<T>::Node::Node(Node *previous, const T &data, Node *next)
-	: previous(previous), data(data), next(next)
+template<typename T, template <typename> class Allocator>
+template<typename... Args>
+inline DoublyLinkedList<T, Allocator>::Node::Node(Node *previous, Node *next, Args&&... args)
+	: previous(previous), data(std::forward<Args>(args)...), next(next)
 {}
 
-template<typename T>
-inline DoublyLinkedList<T>::DoublyLinkedList()
+template<typename T, template <typename> class Allocator>
+inline DoublyLinkedList<T, Allocator>::DoublyLinkedList()
 	: first(nullptr), last(nullptr), count(0)
 {
 }
 
-template<typename T>
-inline DoublyLinkedList<T>::DoublyLinkedList(const DoublyLinkedList<T> &other)
+template<typename T, template <typename> class Allocator>
+inline DoublyLinkedList<T, Allocator>::DoublyLinkedList(const DoublyLinkedList<T, Allocator> &other)
 	: DoublyLinkedList()
 {
 	Node *otherCrr = other.last;
@@ -94,22 +131,35 @@ inline DoublyLinkedList<T>::DoublyLinkedList(const DoublyLinkedList<T> &other)
 	}
 }
 
-template<typename T>
-inline DoublyLinkedList<T>& DoublyLinkedList<T>::operator=(DoublyLinkedList<T> other)
+template<typename T, template <typename> class Allocator>
+inline DoublyLinkedList<T, Allocator>::DoublyLinkedList(DoublyLinkedList<T, Allocator> &&other) noexcept
+	: DoublyLinkedList()
 {
 	std::swap(first, other.first);
 	std::swap(last, other.last);
 	std::swap(count, other.count);
+	nodes.swap(other.nodes);
+}
+
+template<typename T, template <typename> class Allocator>
+inline DoublyLinkedList<T, Allocator>& DoublyLinkedList<T, Allocator>::operator=(DoublyLinkedList<T, Allocator> other)
+{
+	std::swap(first, other.first);
+	std::swap(last, other.last);
+	std::swap(count, other.count);
+	nodes.swap(other.nodes);
 
 	return *this;
 }
 
-template<typename T>
-inline bool DoublyLinkedList<T>::contains(const T &element) const
+template<typename T, template <typename> class Allocator>
+inline bool DoublyLinkedList<T, Allocator>::contains(const T &element) const
 {
+	HETERO_OPERATION(containsProbes);
 	Node *crr = first;
 	while (crr != nullptr)
 	{
+		HETERO_COUNT(comparisons);
 		if (crr->data == element) return true;
 
 		crr = crr->next;
@@ -118,12 +168,44 @@ inline bool DoublyLinkedList<T>::contains(const T &element) const
 	return false;
 }
 
-template<typename T>
-inline bool DoublyLinkedList<T>::contains(Condition<T> pred) const
+template<typename T, template <typename> class Allocator>
+inline bool DoublyLinkedList<T, Allocator>::contains(PredicateRef<T> pred) const
+{
+	HETERO_OPERATION(containsProbes);
+	return any_of(pred);
+}
+
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::filter(PredicateRef<T> predicate)
+{
+	HETERO_SCOPE();
+	remove_if(predicate);
+}
+
+template<typename T, template <typename> class Allocator>
+template<typename Predicate, typename>
+inline bool DoublyLinkedList<T, Allocator>::contains(Predicate pred) const
+{
+	HETERO_OPERATION(containsProbes);
+	return any_of(pred);
+}
+
+template<typename T, template <typename> class Allocator>
+template<typename Predicate, typename>
+inline void DoublyLinkedList<T, Allocator>::filter(Predicate predicate)
+{
+	HETERO_SCOPE();
+	remove_if(predicate);
+}
+
+template<typename T, template <typename> class Allocator>
+template<typename Predicate>
+inline bool DoublyLinkedList<T, Allocator>::any_of(Predicate pred) const
 {
 	Node *crr = first;
 	while (crr != nullptr)
 	{
+		HETERO_COUNT(predicateEvaluations);
 		if (pred (crr->data)) return true;
 
 		crr = crr->next;
@@ -132,12 +214,14 @@ inline bool DoublyLinkedList<T>::contains(Condition<T> pred) const
 	return false;
 }
 
-template<typename T>
-inline void DoublyLinkedList<T>::filter(Condition<T> predicate)
+template<typename T, template <typename> class Allocator>
+template<typename Predicate>
+inline void DoublyLinkedList<T, Allocator>::remove_if(Predicate predicate)
 {
 	Node *crr = first;
 	while (crr != nullptr)
 	{
+		HETERO_COUNT(predicateEvaluations);
 		if (predicate(crr->data))
 		{
 			if (crr == first)
@@ -156,7 +240,7 @@ inline void DoublyLinkedList<T>::filter(Condition<T> predicate)
 				
 				crr->previous->next = crr->next;
 				crr->next->previous = crr->previous;
-				delete crr;
+				destroy_node(crr);
 				--count;
 
 				crr = next;
@@ -166,28 +250,67 @@ inline void DoublyLinkedList<T>::filter(Condition<T> predicate)
 	}
 }
 
-template<typename T>
-inline void DoublyLinkedList<T>::sort()
+//Bottom-up merge sort - runs[ind] holds a sorted run of 2^ind nodes and every new node is carried
+//through the runs like a binary counter. Only the next pointers are relinked while merging, so the
+//sort is stable, does not allocate and the previous pointers are restored in a single pass at the end.
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::sort()
 {
-	DoublyLinkedList<T> temp = *this;
-	while (!empty()) pop();
+	HETERO_SCOPE();
+	if (count < 2) return;
 
-	while (!temp.empty())
+	Node *runs[64] = {};
+	Node *crr = first;
+	while (crr != nullptr)
 	{
-		T top = temp.pop();
-		if (empty() || top <= peek_front()) push(top);
-		else
+		Node *run = crr;
+		crr = crr->next;
+		run->next = nullptr;
+
+		size_t ind = 0;
+		for (; runs[ind] != nullptr; ind++)
 		{
-			while (!empty() && peek_front() < top) temp.push(pop());
-			push(top);
+			run = merge(runs[ind], run);
+			runs[ind] = nullptr;
 		}
+		runs[ind] = run;
+	}
+
+	first = nullptr;
+	for (Node *run : runs)
+	{
+		if (run != nullptr) first = merge(run, first);
+	}
+
+	Node *previous = nullptr;
+	for (crr = first; crr != nullptr; crr = crr->next)
+	{
+		crr->previous = previous;
+		previous = crr;
 	}
+	last = previous;
+}
+
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::push(const T &element)
+{
+	HETERO_OPERATION(pushes);
+	emplace(element);
 }
 
-template<typename T>
-inline void DoublyLinkedList<T>::push(const T &element)
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::push(T &&element)
 {
-	first = new Node(nullptr, element, first);
+	HETERO_OPERATION(pushes);
+	emplace(std::move(element));
+}
+
+template<typename T, template <typename> class Allocator>
+template<typename... Args>
+inline void DoublyLinkedList<T, Allocator>::emplace(Args&&... args)
+{
+	HETERO_OPERATION(pushes);
+	first = create_node(nullptr, first, std::forward<Args>(args)...);
 
 	if (first->next == nullptr)
 	{
@@ -200,15 +323,16 @@ inline void DoublyLinkedList<T>::push(const T &element)
 	++count;
 }
 
-template<typename T>
-inline T DoublyLinkedList<T>::pop()
+template<typename T, template <typename> class Allocator>
+inline T DoublyLinkedList<T, Allocator>::pop()
 {
+	HETERO_OPERATION(pops);
 	assert(first != nullptr);
 
-	T save = first->data;
+	T save = std::move(first->data);
 	Node *oldFirst = first;
 	first = first->next;
-	delete oldFirst;
+	destroy_node(oldFirst);
 
 	if (first == nullptr)
 	{
@@ -223,46 +347,94 @@ inline T DoublyLinkedList<T>::pop()
 	return save;
 }
 
-template<typename T>
-inline size_t DoublyLinkedList<T>::size() const
+template<typename T, template <typename> class Allocator>
+inline size_t DoublyLinkedList<T, Allocator>::size() const
 {
 	return count;
 }
 
-template<typename T>
-inline short DoublyLinkedList<T>::id() const
+template<typename T, template <typename> class Allocator>
+inline short DoublyLinkedList<T, Allocator>::id() const
 {
 	return 2;
 }
 
-template<typename T>
-inline bool DoublyLinkedList<T>::empty() const
+template<typename T, template <typename> class Allocator>
+inline bool DoublyLinkedList<T, Allocator>::empty() const
 {
 	return count == 0;
 }
 
-template<typename T>
-inline BaseContainer<T>* DoublyLinkedList<T>::clone() const
+template<typename T, template <typename> class Allocator>
+inline BaseContainer<T>* DoublyLinkedList<T, Allocator>::clone() const
+{
+	return new DoublyLinkedList<T, Allocator>(*this);
+}
+
+template<typename T, template <typename> class Allocator>
+inline MemoryUsage DoublyLinkedList<T, Allocator>::memory_usage() const
 {
-	return new DoublyLinkedList<T>(*this);
+	MemoryUsage usage = heap_usage();
+	usage.overhead += sizeof(*this);
+
+	return usage;
 }
 
-template<typename T>
-inline BaseIterator<T>* DoublyLinkedList<T>::begin(bool useRegular) const
+template<typename T, template <typename> class Allocator>
+inline MemoryUsage DoublyLinkedList<T, Allocator>::heap_usage() const
 {
-	return new ListIterator<T>(first);
+	MemoryUsage usage;
+	usage.payload = count * sizeof(T);
+	usage.overhead = count * (sizeof(Node) - sizeof(T));
+	usage.slack = nodes.reserved(count) - count * sizeof(Node);
+
+	return usage;
 }
 
-template<typename T>
-inline BaseIterator<T>* DoublyLinkedList<T>::end() const
+template<typename T, template <typename> class Allocator>
+inline BaseIterator<T>* DoublyLinkedList<T, Allocator>::begin(bool useRegular) const
 {
-	return new ListIterator<T>(nullptr);
+	return new ListIterator<T, Allocator>(first);
 }
 
-template<typename T>
-inline void DoublyLinkedList<T>::push_back(const T &data)
+template<typename T, template <typename> class Allocator>
+inline BaseIterator<T>* DoublyLinkedList<T, Allocator>::end() const
 {
-	last = new Node(last, data, nullptr);
+	return new ListIterator<T, Allocator>(nullptr);
+}
+
+template<typename T, template <typename> class Allocator>
+inline typename DoublyLinkedList<T, Allocator>::Iterator DoublyLinkedList<T, Allocator>::cbegin() const
+{
+	return Iterator(first);
+}
+
+template<typename T, template <typename> class Allocator>
+inline typename DoublyLinkedList<T, Allocator>::Iterator DoublyLinkedList<T, Allocator>::cend() const
+{
+	return Iterator(nullptr);
+}
+
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::push_back(const T &data)
+{
+	HETERO_OPERATION(pushes);
+	emplace_back(data);
+}
+
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::push_back(T &&data)
+{
+	HETERO_OPERATION(pushes);
+	emplace_back(std::move(data));
+}
+
+template<typename T, template <typename> class Allocator>
+template<typename... Args>
+inline void DoublyLinkedList<T, Allocator>::emplace_back(Args&&... args)
+{
+	HETERO_OPERATION(pushes);
+	last = create_node(last, nullptr, std::forward<Args>(args)...);
 
 	if (first == nullptr)
 	{
@@ -275,15 +447,16 @@ inline void DoublyLinkedList<T>::push_back(const T &data)
 	++count;
 }
 
-template<typename T>
-inline T DoublyLinkedList<T>::pop_back()
+template<typename T, template <typename> class Allocator>
+inline T DoublyLinkedList<T, Allocator>::pop_back()
 {
+	HETERO_OPERATION(pops);
 	assert(last != nullptr);
 
-	T save = last->data;
+	T save = std::move(last->data);
 	Node *prvLast = last;
 	last = last->previous;
-	delete prvLast;
+	destroy_node(prvLast);
 
 	if (last == nullptr)
 	{
@@ -298,24 +471,24 @@ inline T DoublyLinkedList<T>::pop_back()
 	return save;
 }
 
-template<typename T>
-inline const T & DoublyLinkedList<T>::peek_front() const
+template<typename T, template <typename> class Allocator>
+inline const T & DoublyLinkedList<T, Allocator>::peek_front() const
 {
 	assert(first != nullptr);
 
 	return first->data;
 }
 
-template<typename T>
-inline const T & DoublyLinkedList<T>::peek_back() const
+template<typename T, template <typename> class Allocator>
+inline const T & DoublyLinkedList<T, Allocator>::peek_back() const
 {
 	assert(last != nullptr);
 
 	return last->data;
 }
 
-template<typename T>
-inline bool DoublyLinkedList<T>::operator==(const DoublyLinkedList<T> &other) const
+template<typename T, template <typename> class Allocator>
+inline bool DoublyLinkedList<T, Allocator>::operator==(const DoublyLinkedList<T, Allocator> &other) const
 {
 	Node *thisCrr = first;
 	Node *otherCrr = other.first;
@@ -331,46 +504,101 @@ inline bool DoublyLinkedList<T>::operator==(const DoublyLinkedList<T> &other) co
 	return thisCrr == nullptr && otherCrr == nullptr;
 }
 
-template<typename T>
-inline DoublyLinkedList<T>::~DoublyLinkedList()
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::clear()
 {
-	DeleteNodeAndChildren(first);
+	//an allocator with bulk release frees whole slabs, so the nodes are visited only when the elements need destructors
+	if (!Allocator<Node>::bulkRelease || !std::is_trivially_destructible<T>::value)
+	{
+		Node *crr = first;
+		while (crr != nullptr)
+		{
+			Node *next = crr->next;
+			destroy_node(crr);
+
+			crr = next;
+		}
+	}
+	nodes.release();
+
+	first = nullptr;
+	last = nullptr;
+	count = 0;
+}
+
+template<typename T, template <typename> class Allocator>
+inline DoublyLinkedList<T, Allocator>::~DoublyLinkedList()
+{
+	clear();
+}
+
+template<typename T, template <typename> class Allocator>
+template<typename... Args>
+inline typename DoublyLinkedList<T, Allocator>::Node * DoublyLinkedList<T, Allocator>::create_node(Node *previous, Node *next, Args&&... args)
+{
+	HETERO_COUNT(nodeAllocations);
+	return new (nodes.allocate()) Node(previous, next, std::forward<Args>(args)...);
+}
+
+template<typename T, template <typename> class Allocator>
+inline void DoublyLinkedList<T, Allocator>::destroy_node(Node *crr)
+{
+	crr->~Node();
+	nodes.deallocate(crr);
 }
 
-template<typename T>
-inline void DoublyLinkedList<T>::DeleteNodeAndChildren(Node *crr)
+template<typename T, template <typename> class Allocator>
+inline typename DoublyLinkedList<T, Allocator>::Node * DoublyLinkedList<T, Allocator>::merge(Node *left, Node *right) const
 {
-	if (crr == nullptr) return;
+	//left holds the earlier elements, so on ties it goes first to keep the sort stable
+	Node *result = nullptr;
+	Node **link = &result;
+	while (left != nullptr && right != nullptr)
+	{
+		HETERO_COUNT(comparisons);
+		if (right->data < left->data)
+		{
+			*link = right;
+			right = right->next;
+		}
+		else
+		{
+			*link = left;
+			left = left->next;
+		}
+
+		link = &(*link)->next;
+	}
+	*link = left != nullptr ? left : right;
 
-	DeleteNodeAndChildren(crr->next);
-	delete crr;
+	return result;
 }
 
-template<typename T>
-inline ListIterator<T>::ListIterator(typename DoublyLinkedList<T>::Node *start)
+template<typename T, template <typename> class Allocator>
+inline ListIterator<T, Allocator>::ListIterator(typename DoublyLinkedList<T, Allocator>::Node *start)
 	: crr(start)
 {}
 
-template<typename T>
-inline void ListIterator<T>::next()
+template<typename T, template <typename> class Allocator>
+inline void ListIterator<T, Allocator>::next()
 {
 	crr = crr->next;
 }
 
-template<typename T>
-inline T ListIterator<T>::value() const
+template<typename T, template <typename> class Allocator>
+inline const T& ListIterator<T, Allocator>::value() const
 {
 	return crr->data;
 }
 
-template<typename T>
-inline bool ListIterator<T>::are_equal(BaseIterator<T> *other) const
+template<typename T, template <typename> class Allocator>
+inline bool ListIterator<T, Allocator>::are_equal(BaseIterator<T> *other) const
 {
-	return ((ListIterator<T>*)other)->crr == crr;
+	return ((ListIterator<T, Allocator>*)other)->crr == crr;
 }
 
-template<typename T>
-inline BaseIterator<T>* ListIterator<T>::clone() const
+template<typename T, template <typename> class Allocator>
+inline BaseIterator<T>* ListIterator<T, Allocator>::clone() const
 {
-	return new ListIterator<T>(*this);
+	return new ListIterator<T, Allocator>(*this);
 }
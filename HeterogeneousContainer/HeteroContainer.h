@@ -5,6 +5,16 @@
 #include "Stack.h"
 #include "Queue.h"
 #include "BinSearchTree.h"
+#include "LoserTree.h"
+#include "Parallel.h"
+#include "BinaryFormat.h"
+#include "MappedView.h"
+#include "BloomFilter.h"
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <algorithm>
 #include <vector>
 
 template <typename T>
@@ -13,6 +23,7 @@ class HeteroContainer
 public:
 	HeteroContainer();
 	HeteroContainer(const HeteroContainer<T>&);
+	HeteroContainer(HeteroContainer<T>&&) noexcept;
 	HeteroContainer<T>& operator=(HeteroContainer<T>);
 
 	enum Type
@@ -20,27 +31,130 @@ public:
 		STACK = 0,
 		QUEUE = 1,
 		LINKED_LIST = 2,
-		BIN_SEARCH_TREE = 3
+		BIN_SEARCH_TREE = 3,
+		BALANCED_BIN_SEARCH_TREE = 4
+	};
+
+	enum Format
+	{
+		TEXT = 0,
+		BINARY = 1 //see BinaryFormat.h; the streams have to be opened with std::ios::binary
 	};
 
 	void add_container(Type);
 	void add_element(const T&);
+	void add_element(T&&);
+	template <typename... Args>
+	void emplace_element(Args&&...); //builds the element in place in the smallest subcontainer (first, when it is summarized)
 	bool contains(const T&) const;
-	bool contains(Condition<T> pred) const;
-	void filter(Condition<T>);
+
+	//balanced loading of a whole batch - the subcontainers end up with the sizes that adding the elements
+	//one by one would give them, but every subcontainer takes its share as one contiguous chunk;
+	//pointers and vector iterators are pushed from where they point, other ranges are copied first
+	void add_elements(const T *first, size_t amount);
+	template <typename Iterator>
+	void add_elements(Iterator first, Iterator last);
 	void sort();
+
+	//Keeps a Bloom filter over every stack, queue and linked list, so contains(const T&) skips the ones that
+	//surely do not hold the element without scanning them. A filter follows the pushes and is rebuilt by the
+	//first lookup after it got stale (after a filter, a load, or when it outgrew its size), so a concurrent
+	//lookup must not be the first one. Needs std::hash<T> or a MembershipHash specialization. The setting
+	//belongs to the object - assignments and loads keep it.
+	void use_membership_filters(bool = true);
+
+	//Keeps a zone map of every subcontainer - the smallest and the largest element and whether they are in
+	//ascending order. contains(const T&), get_element_it and the bound and range iterators skip the
+	//subcontainers whose bounds exclude the element, so when the subcontainers hold disjoint ranges a lookup
+	//touches only one of them. The bounds are widened by the pushes and recomputed by the first lookup after
+	//they got stale (after a filter, a load, or for a new subcontainer), so like the filters they are off by
+	//default and with them a concurrent lookup must not be the first one. The bounds are copies of elements.
+	//The setting belongs to the object - assignments and loads keep it.
+	void use_zone_maps(bool = true);
+	bool container_sorted(size_t) const; //known to be in ascending order; false when unknown (no zone maps)
+	bool is_sorted() const; //every subcontainer is known to be sorted, so the sort iterators can be used
+
+	//a predicate is any callable that takes const T& and returns bool - functions, capturing lambdas, functors;
+	//it is inlined into the scan of every subcontainer of a known type
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	void filter(Predicate);
+
+	//the same operations spread over the subcontainers on up to threadsCount threads;
+	//the predicates are called concurrently, so they must not modify shared state
+	bool contains(const T&, size_t threadsCount) const;
+	void sort(size_t threadsCount);
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate, size_t threadsCount) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	void filter(Predicate, size_t threadsCount);
+
 	size_t elements_size() const;
 	size_t containers_size() const;
+	Type container_type(size_t) const; //the subcontainers are numbered in the order they were added
+	size_t container_size(size_t) const;
+	//the bytes held by the whole container and by one subcontainer, see MemoryUsage; the container adds its
+	//registry, the iterators are left out since they live only while walking - a SortIterator holds two
+	//iterator objects for every subcontainer
+	MemoryUsage memory_usage() const;
+	MemoryUsage container_memory_usage(size_t) const;
 
 	class SortIterator;
 	SortIterator begin() const; //Container should be sorted in order for the iterator to work properly
 	SortIterator end() const;
 	SortIterator get_element_it(const T&) const;
 
+	//Sorted iterators that start at a position found by seeking every subcontainer directly -
+	//a descent in the trees and a binary search in sorted stacks and queues
+	SortIterator lower_bound(const T&) const; //the first element that is not smaller than the given one
+	SortIterator upper_bound(const T&) const; //the first element that is greater than the given one
+	std::pair<SortIterator, SortIterator> equal_range(const T&) const;
+	std::pair<SortIterator, SortIterator> range(const T &from, const T &to) const; //the elements in [from, to)
+	//the element with the given zero based position in sorted order, found in O(log^2 n) searches in the trees and
+	//in the stacks and queues that are sorted; any other subcontainer is copied and sorted on every call
+	T select(size_t) const;
+
 	class SpecificIterator;
 	SpecificIterator specific_begin(bool inDepth = true) const;
 	SpecificIterator specific_end(bool inDepth = true) const;
 
+	void save(std::ostream&, Format = TEXT) const;
+	void load(std::istream&, Format = TEXT); //on malformed input the stream fails and the container stays unchanged
+
+	//Maps a binary snapshot file into memory and exposes its subcontainers as read only views over the mapped
+	//bytes; a subcontainer is copied into a regular one only when it is first modified. Types without raw payloads
+	//fall back to a regular binary load. The checksum is verified only on request since it reads the whole file.
+	bool load_mapped(const char *fileName, bool verifyChecksum = false);
+
+#ifdef HETERO_INSTRUMENTATION
+	//latencies of the whole container operations in nanoseconds; load covers load_mapped too
+	struct Latencies
+	{
+		Instrumentation::Histogram sort;
+		Instrumentation::Histogram filter;
+		Instrumentation::Histogram save;
+		Instrumentation::Histogram load;
+	};
+
+	struct ContainerSnapshot
+	{
+		Type type;
+		size_t size;
+		Instrumentation::Counters counters;
+	};
+
+	//a copy of the instrumentation data taken at one moment, for exporting
+	struct InstrumentationSnapshot
+	{
+		std::vector<ContainerSnapshot> containers; //in the order the subcontainers were added
+		Latencies latencies;
+	};
+
+	InstrumentationSnapshot instrumentation_snapshot() const;
+	void reset_instrumentation();
+#endif
+
 	template <typename M>
 	friend std::ostream& operator<<(std::ostream&, const HeteroContainer<M>&);
 
@@ -50,57 +164,118 @@ public:
 	~HeteroContainer();
 
 private:
-	struct Node
+	struct Entry
 	{
 		BaseContainer<T> *container;
 		Type type;
-		Node *next;
+		size_t size; //cached container->size(), kept up to date by every operation that changes it
+		mutable BloomFilter membership; //see use_membership_filters
+		mutable bool membershipValid;
+		mutable std::optional<T> minimum; //the zone map, see use_zone_maps; empty for an empty subcontainer
+		mutable std::optional<T> maximum;
+		mutable bool sorted;
+		mutable bool zoneValid;
+
+		Entry(BaseContainer<T>*, Type);
+	};
 
-		Node(BaseContainer<T>*, Node*, Type);
+	//a subcontainer seen as a sorted sequence - trees answer from their subtree sizes, sorted stacks and queues
+	//by binary search in their buffers, the rest is sorted in a copy
+	struct RankedSource
+	{
+		const BinSearchTree<T> *tree;
+		const RingBuffer<T> *ring;
+		std::vector<T> elements;
+
+		RankedSource(const BaseContainer<T>*);
+		size_t size() const;
+		const T& select(size_t) const;
+		size_t rank(const T&, bool) const;
+	};
+
+	//heap order for balanced loading - the smallest subcontainer (the first one on ties) is on top
+	struct LargerSize
+	{
+		const std::vector<Entry> *entries;
+
+		bool operator()(size_t, size_t) const;
 	};
 
 	BaseContainer<T>* new_container(Type) const;
-	Node* get_smallest() const;
-	void DeleteNodeAndChildren(Node*);
 
-	Node *first;
-	Node *last;
-	size_t count;
+	//balanced loading - calls push(entry) for the smallest subcontainer and updates its size
+	template <typename Push>
+	void push_to_smallest(Push);
+	template <typename Iterator>
+	void add_range(Iterator, Iterator, std::true_type contiguous);
+	template <typename Iterator>
+	void add_range(Iterator, Iterator, std::false_type contiguous);
+	void note_push(Entry&, const T&); //updates the summaries of the subcontainer before the element goes in
+
+	bool has_membership(const Entry&) const;
+	bool may_contain(const Entry&, uint64_t) const; //false only when the filter rules the element out
+	void remember(Entry&, uint64_t);
+	void forget_membership();
+	void refresh_zone(const Entry&) const;
+	bool excluded(const Entry&, const T&) const; //the zone map rules the element out
+	int bound_position(const Entry&, const T&, bool upper) const; //-1 at the beginning, 1 at the end, 0 unknown
+	void forget_zones();
+
+	//calls the visitor with the subcontainer as its concrete type, so template operations get inlined;
+	//containers of other classes (the mapped views) are passed through the virtual interface
+	template <typename Result, typename Visitor>
+	static Result visit(const Entry&, Visitor);
+
+	std::vector<size_t> largest_first() const;
+	void rebuild_sizes();
+	void swap(HeteroContainer<T>&);
+	std::string binary_payload(const Entry&) const;
+
+	std::vector<Entry> entries; //the subcontainers next to each other, indexed by their number
+	std::vector<size_t> sizeHeap; //indexes of the subcontainers
+	size_t count; //the amount of elements in all subcontainers
+	bool filtersEnabled;
+	bool zonesEnabled;
+#ifdef HETERO_INSTRUMENTATION
+	mutable Latencies latencies; //belong to the object - not exchanged by swap, so they survive a load
+#endif
 
 public:
 	class SortIterator
 	{
 	public:
-		SortIterator(Node*, bool = false);
+		SortIterator(const HeteroContainer<T>*, bool = false);
+		SortIterator(const HeteroContainer<T>*, const T&, bool upper); //starts at the lower (upper) bound of the element
 		SortIterator(const SortIterator&);
 		SortIterator& operator=(SortIterator);
 		
 		SortIterator& operator++();
-		T operator*() const;
-		bool operator!= (SortIterator&) const;
+		const T& operator*() const;
+		bool operator!= (const SortIterator&) const;
 
 		~SortIterator();
 
 	private:
-		void wind();
+		void refresh(size_t);
+		void start_merge();
 
-		Node *first;
+		const HeteroContainer<T> *owner;
 		std::vector<BaseIterator<T>*> iterators;
 		std::vector<BaseIterator<T>*> ends;
-		int crrMin;
+		LoserTree<T> heads; //k-way merge over the cached current values of the iterators
 		size_t processedElements;
 	};
 
 	class SpecificIterator
 	{
 	public:
-		SpecificIterator(Node*, bool = false, bool = true);
+		SpecificIterator(const HeteroContainer<T>*, bool = false, bool = true);
 		SpecificIterator(const SpecificIterator&);
 		SpecificIterator& operator=(SpecificIterator);
 
 		SpecificIterator& operator++();
-		T operator*() const;
-		bool operator!= (SpecificIterator&) const;
+		const T& operator*() const;
+		bool operator!= (const SpecificIterator&) const;
 
 		~SpecificIterator();
 
@@ -108,7 +283,7 @@ public:
 		void wind_depth();
 		void wind_breadth();
 
-		Node *first;
+		const HeteroContainer<T> *owner;
 		std::vector<BaseIterator<T>*> iterators;
 		std::vector<BaseIterator<T>*> ends;
 		int ind;
@@ -119,34 +294,34 @@ public:
 
 template<typename T>
 inline HeteroContainer<T>::HeteroContainer()
-	: first(nullptr), last(nullptr), count(0)
+	: count(0), filtersEnabled(false), zonesEnabled(false)
 {}
 
 template<typename T>
 inline HeteroContainer<T>::HeteroContainer(const HeteroContainer<T> &other)
+	: HeteroContainer()
 {
-	if (other.first == nullptr) return;
-	first = new Node(other.first->container->clone(), nullptr, (Type)other.first->container->id());
+	entries.reserve(other.entries.size());
+	for (const Entry &entry : other.entries) entries.push_back(Entry(entry.container->clone(), entry.type));
+	filtersEnabled = other.filtersEnabled;
+	zonesEnabled = other.zonesEnabled;
 
-	Node *otherCrr = other.first;
-	Node *thisCrr = first;
-	while (otherCrr->next != nullptr)
-	{
-		thisCrr->next = new Node(otherCrr->next->container->clone(), nullptr, (Type)otherCrr->next->container->id());
-		thisCrr = thisCrr->next;
-		otherCrr = otherCrr->next;
-	}
+	rebuild_sizes();
+}
 
-	count = other.count;
-	last = thisCrr;
+template<typename T>
+inline HeteroContainer<T>::HeteroContainer(HeteroContainer<T> &&other) noexcept
+	: HeteroContainer()
+{
+	swap(other);
+	filtersEnabled = other.filtersEnabled;
+	zonesEnabled = other.zonesEnabled;
 }
 
 template<typename T>
 inline HeteroContainer<T>& HeteroContainer<T>::operator=(HeteroContainer<T> other)
 {
-	std::swap(first, other.first);
-	std::swap(last, other.last);
-	std::swap(count, other.count);
+	swap(other);
 
 	return *this;
 }
@@ -154,142 +329,638 @@ inline HeteroContainer<T>& HeteroContainer<T>::operator=(HeteroContainer<T> othe
 template<typename T>
 inline void HeteroContainer<T>::add_container(Type type)
 {
-	if (last == nullptr)
+	entries.push_back(Entry(new_container(type), type));
+	sizeHeap.push_back(entries.size() - 1);
+	std::push_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &entries });
+}
+
+template<typename T>
+inline void HeteroContainer<T>::add_element(const T &element)
+{
+	push_to_smallest([this, &element](Entry &entry)
 	{
-		last = new Node(new_container(type), nullptr, type);
-		first = last;
+		note_push(entry, element);
+		entry.container->push(element);
+	});
+}
+
+template<typename T>
+inline void HeteroContainer<T>::add_element(T &&element)
+{
+	push_to_smallest([this, &element](Entry &entry)
+	{
+		note_push(entry, element);
+		entry.container->push(std::move(element));
+	});
+}
+
+template<typename T>
+template<typename... Args>
+inline void HeteroContainer<T>::emplace_element(Args&&... args)
+{
+	//the summaries need the element itself, so it is built first
+	if (filtersEnabled || zonesEnabled)
+	{
+		add_element(T(std::forward<Args>(args)...));
+		return;
 	}
-	else
+
+	push_to_smallest([&args...](Entry &entry) { entry.container->emplace(std::forward<Args>(args)...); });
+}
+
+template<typename T>
+inline void HeteroContainer<T>::add_elements(const T *first, size_t amount)
+{
+	assert(!entries.empty() || amount == 0);
+	if (amount == 0) return;
+
+	//water filling: the smallest subcontainers are raised level by level until the batch runs out
+	std::vector<size_t> order(entries.size());
+	for (size_t ind = 0; ind < order.size(); ind++) order[ind] = ind;
+	std::stable_sort(order.begin(), order.end(), [this](size_t left, size_t right) { return entries[left].size < entries[right].size; });
+
+	size_t level = entries[order[0]].size;
+	size_t raised = 0;
+	size_t remaining = amount;
+	while (true)
 	{
-		last->next = new Node(new_container(type), nullptr, type);
-		last = last->next;
+		while (raised < order.size() && entries[order[raised]].size == level) ++raised;
+
+		if (raised == order.size() || (entries[order[raised]].size - level) * raised > remaining)
+		{
+			level += remaining / raised;
+			remaining %= raised;
+			break;
+		}
+
+		remaining -= (entries[order[raised]].size - level) * raised;
+		level = entries[order[raised]].size;
 	}
 
-	++count;
+	//the elements that are left go one each to the first subcontainers on the level, like the ties in add_element
+	std::sort(order.begin(), order.begin() + raised);
+	for (size_t ind = 0; ind < raised; ind++)
+	{
+		Entry &entry = entries[order[ind]];
+		size_t chunk = level - entry.size + (ind < remaining ? 1 : 0);
+		if (filtersEnabled || zonesEnabled)
+		{
+			for (size_t element = 0; element < chunk; element++) note_push(entry, first[element]);
+		}
+		entry.container->push_range(first, chunk);
+		entry.size += chunk;
+		first += chunk;
+	}
+
+	count += amount;
+	std::make_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &entries });
 }
 
 template<typename T>
-inline void HeteroContainer<T>::add_element(const T &element)
+template<typename Iterator>
+inline void HeteroContainer<T>::add_elements(Iterator first, Iterator last)
 {
-	assert(count != 0);
-	get_smallest()->container->push(element);
+	//std::vector<bool> packs its elements, so its iterators do not point to them
+	typedef std::integral_constant<bool, !std::is_same<T, bool>::value &&
+		(std::is_same<Iterator, T*>::value || std::is_same<Iterator, const T*>::value ||
+		std::is_same<Iterator, typename std::vector<T>::iterator>::value ||
+		std::is_same<Iterator, typename std::vector<T>::const_iterator>::value)> Contiguous;
+
+	add_range(first, last, Contiguous());
+}
+
+template<typename T>
+template<typename Iterator>
+inline void HeteroContainer<T>::add_range(Iterator first, Iterator last, std::true_type)
+{
+	size_t amount = last - first;
+	add_elements(amount == 0 ? nullptr : &*first, amount);
+}
+
+template<typename T>
+template<typename Iterator>
+inline void HeteroContainer<T>::add_range(Iterator first, Iterator last, std::false_type)
+{
+	std::vector<T> batch(first, last);
+	add_elements(batch.data(), batch.size());
 }
 
 template<typename T>
 inline bool HeteroContainer<T>::contains(const T &element) const
 {
-	Node *crr = first;
-	while (crr != nullptr)
+	uint64_t hash = filtersEnabled ? MembershipHash<T>::of(element) : 0;
+	for (const Entry &entry : entries)
 	{
-		if (crr->container->contains(element)) return true;
+		if (!excluded(entry, element) && may_contain(entry, hash) && entry.container->contains(element)) return true;
+	}
 
-		crr = crr->next;
+	return false;
+}
+
+template<typename T>
+template<typename Predicate, typename>
+inline bool HeteroContainer<T>::contains(Predicate pred) const
+{
+	for (const Entry &entry : entries)
+	{
+		if (visit<bool>(entry, [&pred](const auto &container) { return container.contains(pred); })) return true;
 	}
 
 	return false;
 }
 
 template<typename T>
-inline bool HeteroContainer<T>::contains(Condition<T> pred) const
+template<typename Predicate, typename>
+inline void HeteroContainer<T>::filter(Predicate predicate)
 {
-	Node *crr = first;
-	while (crr != nullptr)
+	HETERO_TIME(latencies.filter);
+	for (const Entry &entry : entries)
 	{
-		if (crr->container->contains(pred)) return true;
+		visit<void>(entry, [&predicate](auto &container) { container.filter(predicate); });
+	}
 
-		crr = crr->next;
+	rebuild_sizes();
+	forget_membership();
+	forget_zones();
+}
+
+template<typename T>
+inline void HeteroContainer<T>::sort()
+{
+	HETERO_TIME(latencies.sort);
+	for (const Entry &entry : entries)
+	{
+		entry.container->sort();
+		entry.sorted = true;
 	}
+}
 
-	return false;
+template<typename T>
+inline bool HeteroContainer<T>::contains(const T &element, size_t threadsCount) const
+{
+	uint64_t hash = filtersEnabled ? MembershipHash<T>::of(element) : 0;
+	std::vector<size_t> order = largest_first();
+	return parallel_any(order.size(), threadsCount, [this, &order, &element, hash](size_t ind, const std::atomic<bool> &stop)
+	{
+		const Entry &entry = entries[order[ind]];
+		if (excluded(entry, element) || !may_contain(entry, hash)) return false;
+		if (entry.type == BIN_SEARCH_TREE || entry.type == BALANCED_BIN_SEARCH_TREE) return entry.container->contains(element);
+
+		//the linear scans end as soon as another thread finds the element
+		return visit<bool>(entry, [&element, &stop](const auto &container)
+		{
+			return container.contains([&element, &stop](const T &crr) { return stop.load(std::memory_order_relaxed) || crr == element; });
+		});
+	});
 }
 
 template<typename T>
-inline void HeteroContainer<T>::filter(Condition<T> predicate)
+template<typename Predicate, typename>
+inline bool HeteroContainer<T>::contains(Predicate pred, size_t threadsCount) const
 {
-	Node *crr = first;
-	while (crr != nullptr)
+	std::vector<size_t> order = largest_first();
+	return parallel_any(order.size(), threadsCount, [this, &order, &pred](size_t ind, const std::atomic<bool> &stop)
 	{
-		crr->container->filter(predicate);
+		//the scan ends as soon as another thread finds a match
+		auto stoppable = [&pred, &stop](const T &element) { return stop.load(std::memory_order_relaxed) || pred(element); };
+		return visit<bool>(entries[order[ind]], [&stoppable](const auto &container) { return container.contains(stoppable); });
+	});
+}
+
+template<typename T>
+template<typename Predicate, typename>
+inline void HeteroContainer<T>::filter(Predicate predicate, size_t threadsCount)
+{
+	HETERO_TIME(latencies.filter);
+	std::vector<size_t> order = largest_first();
+	parallel_for(order.size(), threadsCount, [this, &order, &predicate](size_t ind)
+	{
+		visit<void>(entries[order[ind]], [&predicate](auto &container) { container.filter(predicate); });
+	});
+
+	rebuild_sizes();
+	forget_membership();
+	forget_zones();
+}
 
-		crr = crr->next;
+template<typename T>
+inline void HeteroContainer<T>::sort(size_t threadsCount)
+{
+	HETERO_TIME(latencies.sort);
+	//the largest subcontainers are started first, so the small ones fill the gaps at the end
+	std::vector<size_t> order = largest_first();
+	parallel_for(order.size(), threadsCount, [this, &order](size_t ind) { entries[order[ind]].container->sort(); });
+	for (const Entry &entry : entries) entry.sorted = true;
+}
+
+template<typename T>
+inline size_t HeteroContainer<T>::elements_size() const
+{
+	return count;
+}
+
+template<typename T>
+inline void HeteroContainer<T>::save(std::ostream &outStr, Format format) const
+{
+	HETERO_TIME(latencies.save);
+	if (format == TEXT)
+	{
+		outStr << *this;
+		return;
 	}
+
+	typedef BinaryFormat::Codec<T> Codec;
+
+	//the payload lengths go to the header, so payloads of non raw types are encoded up front;
+	//raw payloads have a known length and are encoded one at a time while writing
+	std::vector<std::string> encoded;
+	std::string header(BinaryFormat::MAGIC, 4);
+	BinaryFormat::append(header, BinaryFormat::VERSION, 2);
+	BinaryFormat::append(header, Codec::raw ? BinaryFormat::RAW_PAYLOAD : 0, 2);
+	BinaryFormat::append(header, Codec::raw ? sizeof(T) : 0, 4);
+	BinaryFormat::append(header, 0, 4);
+	BinaryFormat::append(header, entries.size(), 8);
+	for (const Entry &entry : entries)
+	{
+		if (!Codec::raw) encoded.push_back(binary_payload(entry));
+
+		BinaryFormat::append(header, entry.type, 4);
+		BinaryFormat::append(header, 0, 4);
+		BinaryFormat::append(header, entry.size, 8);
+		BinaryFormat::append(header, Codec::raw ? entry.size * sizeof(T) : encoded.back().size(), 8);
+	}
+
+	BinaryFormat::Checksum checksum;
+	auto write = [&outStr, &checksum](const std::string &bytes)
+	{
+		checksum.update(bytes.data(), bytes.size());
+		outStr.write(bytes.data(), bytes.size());
+	};
+
+	write(header);
+	for (size_t ind = 0; ind < entries.size(); ind++)
+	{
+		std::string payload = Codec::raw ? binary_payload(entries[ind]) : std::move(encoded[ind]);
+		payload.append(BinaryFormat::padding(payload.size()), '\0');
+		write(payload);
+	}
+
+	std::string footer;
+	BinaryFormat::append(footer, checksum.value(), 8);
+	outStr.write(footer.data(), footer.size());
 }
 
 template<typename T>
-inline void HeteroContainer<T>::sort()
+inline void HeteroContainer<T>::load(std::istream &inStr, Format format)
 {
-	Node *crr = first;
-	while (crr != nullptr)
+	HETERO_TIME(latencies.load);
+	if (format == TEXT)
 	{
-		crr->container->sort();
+		inStr >> *this;
+		return;
+	}
+
+	typedef BinaryFormat::Codec<T> Codec;
+
+	BinaryFormat::Checksum checksum;
+	auto read = [&inStr, &checksum](std::string &bytes, size_t length)
+	{
+		//in bounded chunks, so a corrupted length runs into the end of the stream instead of being allocated up front
+		const size_t CHUNK = 1 << 16;
+		bytes.clear();
+		while (bytes.size() < length)
+		{
+			size_t offset = bytes.size();
+			bytes.resize(offset + std::min(CHUNK, length - offset));
+			if (!inStr.read(&bytes[offset], bytes.size() - offset)) return false;
+		}
+		checksum.update(bytes.data(), length);
+
+		return true;
+	};
 
-		crr = crr->next;
+	std::string header;
+	if (!read(header, BinaryFormat::HEADER_SIZE) ||
+		header.compare(0, 4, BinaryFormat::MAGIC, 4) != 0 ||
+		BinaryFormat::extract(&header[4], 2) != BinaryFormat::VERSION ||
+		BinaryFormat::extract(&header[6], 2) != (Codec::raw ? BinaryFormat::RAW_PAYLOAD : 0) ||
+		BinaryFormat::extract(&header[8], 4) != (Codec::raw ? sizeof(T) : 0))
+	{
+		inStr.setstate(std::ios::failbit);
+		return;
+	}
+
+	size_t amount = (size_t)BinaryFormat::extract(&header[16], 8);
+	std::vector<std::pair<size_t, size_t>> sizes; //elements count and payload length of every subcontainer
+	HeteroContainer<T> result;
+	for (size_t ind = 0; ind < amount; ind++)
+	{
+		std::string entry;
+		if (!read(entry, BinaryFormat::ENTRY_SIZE) || BinaryFormat::extract(&entry[0], 4) > BALANCED_BIN_SEARCH_TREE)
+		{
+			inStr.setstate(std::ios::failbit);
+			return;
+		}
+
+		result.add_container((Type)BinaryFormat::extract(&entry[0], 4));
+		sizes.push_back(std::make_pair((size_t)BinaryFormat::extract(&entry[8], 8), (size_t)BinaryFormat::extract(&entry[16], 8)));
+	}
+
+	std::string payload;
+	std::vector<T> sorted;
+	for (size_t ind = 0; ind < amount; ind++)
+	{
+		//the lengths are checked by division, so a corrupted count or length cannot overflow them
+		if ((Codec::raw && (sizes[ind].second % sizeof(T) != 0 || sizes[ind].second / sizeof(T) != sizes[ind].first)) ||
+			sizes[ind].second > SIZE_MAX - BinaryFormat::ALIGNMENT ||
+			!read(payload, sizes[ind].second + BinaryFormat::padding(sizes[ind].second)))
+		{
+			inStr.setstate(std::ios::failbit);
+			return;
+		}
+
+		//the ascending payload of a tree is pushed as one batch, which rebuilds it balanced
+		Entry &entry = result.entries[ind];
+		bool tree = entry.type == BIN_SEARCH_TREE || entry.type == BALANCED_BIN_SEARCH_TREE;
+		const char *position = payload.data();
+		const char *end = position + sizes[ind].second;
+		sorted.clear();
+		for (size_t element = 0; element < sizes[ind].first && position != nullptr; element++)
+		{
+			T value;
+			position = Codec::decode(position, end, value);
+			if (position == nullptr) break;
+
+			if (tree) sorted.push_back(std::move(value));
+			else entry.container->push(std::move(value));
+		}
+
+		if (position != end)
+		{
+			inStr.setstate(std::ios::failbit);
+			return;
+		}
+		if (tree) entry.container->push_range(sorted.data(), sorted.size());
+	}
+
+	std::string footer(8, '\0');
+	inStr.read(&footer[0], 8);
+	if (!inStr || BinaryFormat::extract(&footer[0], 8) != checksum.value())
+	{
+		inStr.setstate(std::ios::failbit);
+		return;
 	}
+
+	result.rebuild_sizes();
+	swap(result);
 }
 
 template<typename T>
-inline size_t HeteroContainer<T>::elements_size() const
+inline bool HeteroContainer<T>::load_mapped(const char *fileName, bool verifyChecksum)
 {
-	size_t result = 0;
-	Node *crr = first;
-	while (crr != nullptr)
+	typedef BinaryFormat::Codec<T> Codec;
+
+	if (!Codec::raw || !BinaryFormat::little_endian_host() || alignof(T) > BinaryFormat::ALIGNMENT)
 	{
-		result += crr->container->size();
-	
-		crr = crr->next;
+		std::ifstream inpFile(fileName, std::ios::binary);
+		load(inpFile, BINARY);
+
+		return (bool)inpFile;
 	}
 
-	return result;
+	HETERO_TIME(latencies.load);
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->open(fileName)) return false;
+
+	const char *data = file->data();
+	size_t length = file->size();
+	if (length < BinaryFormat::HEADER_SIZE + 8 ||
+		memcmp(data, BinaryFormat::MAGIC, 4) != 0 ||
+		BinaryFormat::extract(data + 4, 2) != BinaryFormat::VERSION ||
+		BinaryFormat::extract(data + 6, 2) != BinaryFormat::RAW_PAYLOAD ||
+		BinaryFormat::extract(data + 8, 4) != sizeof(T))
+	{
+		return false;
+	}
+
+	size_t amount = (size_t)BinaryFormat::extract(data + 16, 8);
+	if (amount > (length - BinaryFormat::HEADER_SIZE) / BinaryFormat::ENTRY_SIZE) return false;
+
+	HeteroContainer<T> result;
+	size_t offset = BinaryFormat::HEADER_SIZE + amount * BinaryFormat::ENTRY_SIZE;
+	for (size_t ind = 0; ind < amount; ind++)
+	{
+		const char *entry = data + BinaryFormat::HEADER_SIZE + ind * BinaryFormat::ENTRY_SIZE;
+		Type type = (Type)BinaryFormat::extract(entry, 4);
+		size_t elementsAmount = (size_t)BinaryFormat::extract(entry + 8, 8);
+		size_t payloadLength = (size_t)BinaryFormat::extract(entry + 16, 8);
+		if (type > BALANCED_BIN_SEARCH_TREE || elementsAmount > length / sizeof(T) ||
+			payloadLength != elementsAmount * sizeof(T) ||
+			payloadLength + BinaryFormat::padding(payloadLength) + 8 > length - offset)
+		{
+			return false;
+		}
+
+		//stacks and linked lists are loaded by pushing to the front, so they iterate the payload backwards;
+		//the payload of a tree is in ascending order
+		bool reversed = type == STACK || type == LINKED_LIST;
+		bool tree = type == BIN_SEARCH_TREE || type == BALANCED_BIN_SEARCH_TREE;
+		const T *elements = reinterpret_cast<const T*>(data + offset);
+		BaseContainer<T> *view = new MappedView<T>(file, elements, elementsAmount, new_container(type), reversed, tree);
+
+		result.entries.push_back(Entry(view, type));
+
+		offset += payloadLength + BinaryFormat::padding(payloadLength);
+	}
+
+	if (offset + 8 != length) return false;
+	if (verifyChecksum)
+	{
+		BinaryFormat::Checksum checksum;
+		checksum.update(data, offset);
+		if (BinaryFormat::extract(data + offset, 8) != checksum.value()) return false;
+	}
+
+	result.rebuild_sizes();
+	swap(result);
+
+	return true;
 }
 
 template<typename T>
 inline size_t HeteroContainer<T>::containers_size() const
 {
-	return count;
+	return entries.size();
 }
 
+template<typename T>
+inline typename HeteroContainer<T>::Type HeteroContainer<T>::container_type(size_t ind) const
+{
+	assert(ind < entries.size());
+
+	return entries[ind].type;
+}
+
+template<typename T>
+inline size_t HeteroContainer<T>::container_size(size_t ind) const
+{
+	assert(ind < entries.size());
+
+	return entries[ind].size;
+}
+
+template<typename T>
+inline MemoryUsage HeteroContainer<T>::memory_usage() const
+{
+	MemoryUsage usage;
+	usage.overhead = sizeof(*this) + entries.size() * sizeof(Entry) + sizeHeap.size() * sizeof(size_t);
+	usage.slack = (entries.capacity() - entries.size()) * sizeof(Entry) + (sizeHeap.capacity() - sizeHeap.size()) * sizeof(size_t);
+	for (const Entry &entry : entries)
+	{
+		usage += entry.container->memory_usage();
+		usage.overhead += entry.membership.memory();
+	}
+
+	return usage;
+}
+
+template<typename T>
+inline MemoryUsage HeteroContainer<T>::container_memory_usage(size_t ind) const
+{
+	assert(ind < entries.size());
+
+	return entries[ind].container->memory_usage();
+}
+
+#ifdef HETERO_INSTRUMENTATION
+template<typename T>
+inline typename HeteroContainer<T>::InstrumentationSnapshot HeteroContainer<T>::instrumentation_snapshot() const
+{
+	InstrumentationSnapshot snapshot;
+	snapshot.containers.reserve(entries.size());
+	for (const Entry &entry : entries) snapshot.containers.push_back(ContainerSnapshot{ entry.type, entry.size, entry.container->counters() });
+	snapshot.latencies = latencies;
+
+	return snapshot;
+}
+
+template<typename T>
+inline void HeteroContainer<T>::reset_instrumentation()
+{
+	for (Entry &entry : entries) entry.container->reset_counters();
+	latencies = Latencies();
+}
+#endif
+
 template<typename T>
 inline typename HeteroContainer<T>::SortIterator HeteroContainer<T>::begin() const
 {
-	return SortIterator(first);
+	return SortIterator(this);
 }
 
 template<typename T>
 inline typename HeteroContainer<T>::SortIterator HeteroContainer<T>::end() const
 {
-	return SortIterator(first, true);
+	return SortIterator(this, true);
 }
 
 template<typename T>
 inline typename HeteroContainer<T>::SortIterator HeteroContainer<T>::get_element_it(const T &element) const
 {
-	SortIterator it = begin();
-	
-	while (it != end() && *it != element)
+	if (std::all_of(entries.begin(), entries.end(), [this, &element](const Entry &entry) { return excluded(entry, element); })) return end();
+
+	SortIterator it = lower_bound(element);
+	if (it != end() && *it != element) return end();
+
+	return it;
+}
+
+template<typename T>
+inline typename HeteroContainer<T>::SortIterator HeteroContainer<T>::lower_bound(const T &element) const
+{
+	return SortIterator(this, element, false);
+}
+
+template<typename T>
+inline typename HeteroContainer<T>::SortIterator HeteroContainer<T>::upper_bound(const T &element) const
+{
+	return SortIterator(this, element, true);
+}
+
+template<typename T>
+inline std::pair<typename HeteroContainer<T>::SortIterator, typename HeteroContainer<T>::SortIterator> HeteroContainer<T>::equal_range(const T &element) const
+{
+	return std::make_pair(lower_bound(element), upper_bound(element));
+}
+
+template<typename T>
+inline std::pair<typename HeteroContainer<T>::SortIterator, typename HeteroContainer<T>::SortIterator> HeteroContainer<T>::range(const T &from, const T &to) const
+{
+	return std::make_pair(lower_bound(from), lower_bound(from < to ? to : from));
+}
+
+template<typename T>
+inline T HeteroContainer<T>::select(size_t position) const
+{
+	assert(position < elements_size());
+
+	//Every source keeps a window [low, high) of positions that may still hold the answer. The middle of the widest
+	//window is the pivot; the ranks of the pivot in all sources tell on which side the answer is, so at least
+	//the widest window is halved on every step.
+	std::vector<RankedSource> sources;
+	for (const Entry &entry : entries)
 	{
-		if (*it > element) return end();
-		++it;
+		if (entry.size != 0) sources.emplace_back(entry.container);
+	}
+
+	std::vector<size_t> low(sources.size(), 0), high(sources.size());
+	std::vector<size_t> smaller(sources.size()), notGreater(sources.size());
+	for (size_t ind = 0; ind < sources.size(); ind++) high[ind] = sources[ind].size();
+
+	while (true)
+	{
+		size_t widest = 0;
+		for (size_t ind = 1; ind < sources.size(); ind++)
+		{
+			if (high[ind] - low[ind] > high[widest] - low[widest]) widest = ind;
+		}
+
+		const T &pivot = sources[widest].select((low[widest] + high[widest]) / 2);
+		size_t smallerTotal = 0, notGreaterTotal = 0;
+		for (size_t ind = 0; ind < sources.size(); ind++)
+		{
+			smaller[ind] = sources[ind].rank(pivot, false);
+			notGreater[ind] = sources[ind].rank(pivot, true);
+			smallerTotal += smaller[ind];
+			notGreaterTotal += notGreater[ind];
+		}
+
+		if (position >= smallerTotal && position < notGreaterTotal) return pivot;
+
+		for (size_t ind = 0; ind < sources.size(); ind++)
+		{
+			if (position < smallerTotal) high[ind] = std::min(high[ind], smaller[ind]);
+			else low[ind] = std::max(low[ind], notGreater[ind]);
+		}
 	}
-	
-	return it;
 }
 
 template<typename T>
 inline typename HeteroContainer<T>::SpecificIterator HeteroContainer<T>::specific_begin(bool inDepth) const
 {
-	return SpecificIterator(first, false, inDepth);
+	return SpecificIterator(this, false, inDepth);
 }
 
 template<typename T>
 inline typename HeteroContainer<T>::SpecificIterator HeteroContainer<T>::specific_end(bool inDepth) const
 {
-	return SpecificIterator(first, true, inDepth);
+	return SpecificIterator(this, true, inDepth);
 }
 
 template<typename T>
 inline HeteroContainer<T>::~HeteroContainer()
 {
-	DeleteNodeAndChildren(first);
+	for (const Entry &entry : entries) delete entry.container;
 }
 
 template<typename T>
@@ -305,84 +976,404 @@ inline BaseContainer<T> * HeteroContainer<T>::new_container(Type type) const
 		break;
 	case HeteroContainer<T>::BIN_SEARCH_TREE: return new BinSearchTree<T>;
 		break;
+	case HeteroContainer<T>::BALANCED_BIN_SEARCH_TREE: return new BinSearchTree<T>(true);
+		break;
 	default: return nullptr;
 		break;
 	}
 }
 
 template<typename T>
-inline typename HeteroContainer<T>::Node * HeteroContainer<T>::get_smallest() const
+template<typename Push>
+inline void HeteroContainer<T>::push_to_smallest(Push push)
+{
+	assert(!entries.empty());
+
+	std::pop_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &entries });
+	Entry &smallest = entries[sizeHeap.back()];
+	push(smallest);
+	++smallest.size;
+	++count;
+	std::push_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &entries });
+}
+
+template<typename T>
+inline void HeteroContainer<T>::note_push(Entry &entry, const T &element)
+{
+	if (filtersEnabled) remember(entry, MembershipHash<T>::of(element));
+	if (!zonesEnabled || !entry.zoneValid) return;
+
+	if (!entry.minimum)
+	{
+		entry.minimum = element;
+		entry.maximum = element;
+		return;
+	}
+
+	//stacks and linked lists take the element to their front, queues to their back; trees stay sorted
+	if (entry.type == QUEUE) entry.sorted = entry.sorted && !(element < *entry.maximum);
+	else if (entry.type == STACK || entry.type == LINKED_LIST) entry.sorted = entry.sorted && !(*entry.minimum < element);
+
+	if (element < *entry.minimum) entry.minimum = element;
+	if (*entry.maximum < element) entry.maximum = element;
+}
+
+template<typename T>
+inline void HeteroContainer<T>::use_zone_maps(bool enabled)
+{
+	zonesEnabled = enabled;
+	forget_zones();
+}
+
+template<typename T>
+inline bool HeteroContainer<T>::container_sorted(size_t ind) const
+{
+	assert(ind < entries.size());
+	if (!zonesEnabled) return false;
+
+	if (!entries[ind].zoneValid) refresh_zone(entries[ind]);
+	return entries[ind].sorted;
+}
+
+template<typename T>
+inline bool HeteroContainer<T>::is_sorted() const
 {
-	Node *crr = first;
-	Node *min = first;
+	for (size_t ind = 0; ind < entries.size(); ind++)
+	{
+		if (!container_sorted(ind)) return false;
+	}
 
-	while (crr != nullptr)
+	return true;
+}
+
+template<typename T>
+inline void HeteroContainer<T>::refresh_zone(const Entry &entry) const
+{
+	entry.minimum.reset();
+	entry.maximum.reset();
+	entry.sorted = true;
+
+	//the trees are walked in pre-order, which is cheaper than in order
+	bool tree = entry.type == BIN_SEARCH_TREE || entry.type == BALANCED_BIN_SEARCH_TREE;
+	const T *previous = nullptr;
+	BaseIterator<T> *it = entry.container->begin(false);
+	BaseIterator<T> *end = entry.container->end();
+	for (; !it->are_equal(end); it->next())
 	{
-		if (crr->container->size() < min->container->size())
+		const T &value = it->value();
+		if (!entry.minimum)
 		{
-			min = crr;
+			entry.minimum = value;
+			entry.maximum = value;
 		}
+		else
+		{
+			if (value < *entry.minimum) entry.minimum = value;
+			if (*entry.maximum < value) entry.maximum = value;
+		}
+
+		if (!tree && previous != nullptr && value < *previous) entry.sorted = false;
+		previous = &value;
+	}
+	delete it;
+	delete end;
+
+	entry.zoneValid = true;
+}
+
+template<typename T>
+inline bool HeteroContainer<T>::excluded(const Entry &entry, const T &element) const
+{
+	if (!zonesEnabled) return false;
+
+	if (!entry.zoneValid) refresh_zone(entry);
+	return !entry.minimum || element < *entry.minimum || *entry.maximum < element;
+}
+
+template<typename T>
+inline int HeteroContainer<T>::bound_position(const Entry &entry, const T &element, bool upper) const
+{
+	if (!zonesEnabled) return 0;
+
+	if (!entry.zoneValid) refresh_zone(entry);
+	if (!entry.minimum) return 1;
+
+	//the elements before a lower bound are the smaller ones, before an upper bound the not greater ones
+	if (upper ? !(element < *entry.maximum) : *entry.maximum < element) return 1;
+	if (upper ? element < *entry.minimum : !(*entry.minimum < element)) return -1;
+
+	return 0;
+}
+
+template<typename T>
+inline void HeteroContainer<T>::forget_zones()
+{
+	for (Entry &entry : entries)
+	{
+		entry.zoneValid = false;
+		entry.minimum.reset();
+		entry.maximum.reset();
+	}
+}
+
+template<typename T>
+inline void HeteroContainer<T>::use_membership_filters(bool enabled)
+{
+	assert(!enabled || MembershipHash<T>::available);
+
+	filtersEnabled = enabled && MembershipHash<T>::available;
+	forget_membership();
+	if (!filtersEnabled)
+	{
+		for (Entry &entry : entries) entry.membership = BloomFilter();
+	}
+}
+
+template<typename T>
+inline bool HeteroContainer<T>::has_membership(const Entry &entry) const
+{
+	//the trees find an element in logarithmic time anyway
+	return filtersEnabled && entry.type != BIN_SEARCH_TREE && entry.type != BALANCED_BIN_SEARCH_TREE;
+}
+
+template<typename T>
+inline bool HeteroContainer<T>::may_contain(const Entry &entry, uint64_t hash) const
+{
+	if (!has_membership(entry)) return true;
+
+	if (!entry.membershipValid)
+	{
+		//sized for twice the elements, so the filter is rebuilt only after the subcontainer doubles
+		entry.membership.reset(2 * entry.size);
+		BaseIterator<T> *it = entry.container->begin(false);
+		BaseIterator<T> *end = entry.container->end();
+		for (; !it->are_equal(end); it->next()) entry.membership.insert(MembershipHash<T>::of(it->value()));
+		delete it;
+		delete end;
 
-		crr = crr->next;
+		entry.membershipValid = true;
 	}
 
-	return min;
+	return entry.membership.may_contain(hash);
 }
 
 template<typename T>
-inline void HeteroContainer<T>::DeleteNodeAndChildren(Node *crr)
+inline void HeteroContainer<T>::remember(Entry &entry, uint64_t hash)
 {
-	if (crr == nullptr) return;
+	if (!has_membership(entry) || !entry.membershipValid) return;
 
-	DeleteNodeAndChildren(crr->next);
-	delete crr->container;
-	delete crr;
+	if (entry.membership.full()) entry.membershipValid = false;
+	else entry.membership.insert(hash);
+}
+
+template<typename T>
+inline void HeteroContainer<T>::forget_membership()
+{
+	for (Entry &entry : entries) entry.membershipValid = false;
 }
 
 template<typename T>
-inline HeteroContainer<T>::Node::Node(BaseContainer<T> *container, Node *next, Type type)
-	: container(container), next(next), type(type)
+template<typename Result, typename Visitor>
+inline Result HeteroContainer<T>::visit(const Entry &entry, Visitor visitor)
+{
+	switch (entry.type)
+	{
+	case STACK:
+		if (Stack<T> *stack = dynamic_cast<Stack<T>*>(entry.container)) return visitor(*stack);
+		break;
+	case QUEUE:
+		if (Queue<T> *queue = dynamic_cast<Queue<T>*>(entry.container)) return visitor(*queue);
+		break;
+	case LINKED_LIST:
+		if (DoublyLinkedList<T> *list = dynamic_cast<DoublyLinkedList<T>*>(entry.container)) return visitor(*list);
+		break;
+	case BIN_SEARCH_TREE:
+	case BALANCED_BIN_SEARCH_TREE:
+		if (BinSearchTree<T> *tree = dynamic_cast<BinSearchTree<T>*>(entry.container)) return visitor(*tree);
+		break;
+	}
+
+	return visitor(*entry.container);
+}
+
+template<typename T>
+inline std::vector<size_t> HeteroContainer<T>::largest_first() const
+{
+	std::vector<size_t> order(entries.size());
+	for (size_t ind = 0; ind < order.size(); ind++) order[ind] = ind;
+
+	std::stable_sort(order.begin(), order.end(), [this](size_t left, size_t right) { return entries[left].size > entries[right].size; });
+
+	return order;
+}
+
+template<typename T>
+inline void HeteroContainer<T>::rebuild_sizes()
+{
+	sizeHeap.clear();
+	count = 0;
+	for (size_t ind = 0; ind < entries.size(); ind++)
+	{
+		entries[ind].size = entries[ind].container->size();
+		count += entries[ind].size;
+		sizeHeap.push_back(ind);
+	}
+
+	std::make_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &entries });
+}
+
+template<typename T>
+inline void HeteroContainer<T>::swap(HeteroContainer<T> &other)
+{
+	std::swap(entries, other.entries);
+	std::swap(sizeHeap, other.sizeHeap);
+	std::swap(count, other.count);
+}
+
+template<typename T>
+inline std::string HeteroContainer<T>::binary_payload(const Entry &entry) const
+{
+	//the serialization order, like in operator<<, except for the trees that are written in ascending order
+	bool tree = entry.type == BIN_SEARCH_TREE || entry.type == BALANCED_BIN_SEARCH_TREE;
+	std::string payload;
+	BaseIterator<T> *it = entry.container->begin(tree);
+	BaseIterator<T> *end = entry.container->end();
+	while (!it->are_equal(end))
+	{
+		BinaryFormat::Codec<T>::encode(it->value(), payload);
+
+		it->next();
+	}
+	delete it;
+	delete end;
+
+	return payload;
+}
+
+template<typename T>
+inline HeteroContainer<T>::Entry::Entry(BaseContainer<T> *container, Type type)
+	: container(container), type(type), size(container->size()), membershipValid(false), sorted(false), zoneValid(false)
 {}
 
 template<typename T>
-inline HeteroContainer<T>::SortIterator::SortIterator(Node *start, bool isEnd)
-	: crrMin(-1), processedElements(0), first(start)
+inline HeteroContainer<T>::RankedSource::RankedSource(const BaseContainer<T> *container)
+	: tree(dynamic_cast<const BinSearchTree<T>*>(container)), ring(nullptr)
+{
+	if (tree != nullptr) return;
+
+	if (const Stack<T> *stack = dynamic_cast<const Stack<T>*>(container)) ring = &stack->storage();
+	else if (const Queue<T> *queue = dynamic_cast<const Queue<T>*>(container)) ring = &queue->storage();
+	if (ring != nullptr && ring->is_sorted()) return;
+	ring = nullptr;
+
+	BaseIterator<T> *it = container->begin(false);
+	BaseIterator<T> *end = container->end();
+	for (; !it->are_equal(end); it->next()) elements.push_back(it->value());
+	delete it;
+	delete end;
+
+	if (!std::is_sorted(elements.begin(), elements.end())) std::sort(elements.begin(), elements.end());
+}
+
+template<typename T>
+inline size_t HeteroContainer<T>::RankedSource::size() const
+{
+	if (tree != nullptr) return tree->size();
+
+	return ring != nullptr ? ring->size() : elements.size();
+}
+
+template<typename T>
+inline const T & HeteroContainer<T>::RankedSource::select(size_t position) const
+{
+	if (tree != nullptr) return tree->select(position);
+
+	return ring != nullptr ? (*ring)[position] : elements[position];
+}
+
+template<typename T>
+inline size_t HeteroContainer<T>::RankedSource::rank(const T &element, bool inclusive) const
+{
+	if (tree != nullptr) return tree->rank(element, inclusive);
+	if (ring != nullptr) return ring->rank(element, inclusive);
+
+	auto bound = inclusive ? std::upper_bound(elements.begin(), elements.end(), element) :
+		std::lower_bound(elements.begin(), elements.end(), element);
+
+	return bound - elements.begin();
+}
+
+template<typename T>
+inline bool HeteroContainer<T>::LargerSize::operator()(size_t left, size_t right) const
 {
-	Node *crr = start;
-	size_t count = 0;
-	while (crr != nullptr)
+	if ((*entries)[left].size != (*entries)[right].size) return (*entries)[left].size > (*entries)[right].size;
+
+	return left > right;
+}
+
+template<typename T>
+inline HeteroContainer<T>::SortIterator::SortIterator(const HeteroContainer<T> *owner, bool isEnd)
+	: owner(owner), processedElements(0)
+{
+	if (isEnd)
 	{
-		if (!isEnd) iterators.push_back(crr->container->begin());
-		count += crr->container->size();
-		if (!isEnd) ends.push_back(crr->container->end());
-		
-		crr = crr->next;
+		processedElements = owner->count;
+		return;
 	}
 
-	if (isEnd) processedElements = count;
-	else wind();
+	for (const Entry &entry : owner->entries)
+	{
+		iterators.push_back(entry.container->begin());
+		ends.push_back(entry.container->end());
+	}
+
+	start_merge();
+}
+
+template<typename T>
+inline HeteroContainer<T>::SortIterator::SortIterator(const HeteroContainer<T> *owner, const T &element, bool upper)
+	: owner(owner), processedElements(0)
+{
+	//the merge of the subcontainers from their bounds is in the same state as a merge from the beginning
+	//that has consumed exactly the skipped elements, so it compares equal to it and to end()
+	for (const Entry &entry : owner->entries)
+	{
+		//a subcontainer whose zone map lies on one side of the element is not searched at all
+		size_t skipped = 0;
+		switch (owner->bound_position(entry, element, upper))
+		{
+		case -1: iterators.push_back(entry.container->begin());
+			break;
+		case 1: iterators.push_back(entry.container->end());
+			skipped = entry.size;
+			break;
+		default: iterators.push_back(upper ? entry.container->upper_bound(element, skipped) : entry.container->lower_bound(element, skipped));
+			break;
+		}
+		ends.push_back(entry.container->end());
+		processedElements += skipped;
+	}
+
+	start_merge();
 }
 
 template<typename T>
 inline HeteroContainer<T>::SortIterator::SortIterator(const SortIterator &other)
+	: owner(other.owner), heads(other.heads), processedElements(other.processedElements)
 {
 	for (size_t ind = 0; ind < other.iterators.size(); ind++)
 	{
 		iterators.push_back(other.iterators[ind]->clone());
 		ends.push_back(other.ends[ind]->clone());
 	}
-
-	processedElements = other.processedElements;
-	crrMin = other.crrMin;
-	first = other.first;
 }
 
 template<typename T>
 inline typename HeteroContainer<T>::SortIterator & HeteroContainer<T>::SortIterator::operator=(SortIterator other)
 {
-	std::swap(crrMin, other.crrMin);
+	std::swap(heads, other.heads);
 	std::swap(processedElements, other.processedElements);
-	std::swap(first, other.first);
+	std::swap(owner, other.owner);
 	std::swap(iterators, other.iterators);
 	std::swap(ends, other.ends);
 
@@ -392,22 +1383,26 @@ inline typename HeteroContainer<T>::SortIterator & HeteroContainer<T>::SortItera
 template<typename T>
 inline typename HeteroContainer<T>::SortIterator & HeteroContainer<T>::SortIterator::operator++()
 {
+	size_t crrMin = heads.winner();
 	iterators[crrMin]->next();
-	wind();
+	refresh(crrMin);
+	heads.replay(crrMin);
+
+	if (heads.winner() != -1) ++processedElements;
 
 	return *this;
 }
 
 template<typename T>
-inline T HeteroContainer<T>::SortIterator::operator*() const
+inline const T& HeteroContainer<T>::SortIterator::operator*() const
 {
-	return iterators[crrMin]->value();
+	return heads.top();
 }
 
 template<typename T>
-inline bool HeteroContainer<T>::SortIterator::operator!=(SortIterator &other) const
+inline bool HeteroContainer<T>::SortIterator::operator!=(const SortIterator &other) const
 {
-	return first != other.first || crrMin != other.crrMin || processedElements != other.processedElements;
+	return owner != other.owner || heads.winner() != other.heads.winner() || processedElements != other.processedElements;
 }
 
 template<typename T>
@@ -421,37 +1416,32 @@ inline HeteroContainer<T>::SortIterator::~SortIterator()
 }
 
 template<typename T>
-inline void HeteroContainer<T>::SortIterator::wind()
+inline void HeteroContainer<T>::SortIterator::start_merge()
 {
-	bool hasMin = false;
-	crrMin = -1;
+	heads = LoserTree<T>(iterators.size());
+	for (size_t ind = 0; ind < iterators.size(); ind++) refresh(ind);
+	heads.build();
 
-	for (size_t ind = 0; ind < iterators.size(); ind++)
-	{
-		if (!iterators[ind]->are_equal(ends[ind]) && !hasMin) 
-		{
-			crrMin = ind;
-			hasMin = true;
-		}
-		else if (!iterators[ind]->are_equal(ends[ind]) && iterators[crrMin]->value() > iterators[ind]->value())
-		{
-			crrMin = ind;
-		}
-	}
+	if (heads.winner() != -1) ++processedElements;
+}
 
-	if (crrMin != -1) ++processedElements;
+template<typename T>
+inline void HeteroContainer<T>::SortIterator::refresh(size_t ind)
+{
+	//the only place where a subcontainer iterator is asked for its value
+	if (iterators[ind]->are_equal(ends[ind])) heads.exhaust(ind);
+	else heads.set(ind, iterators[ind]->value());
 }
 
 template<typename M>
 inline std::ostream & operator<<(std::ostream &outStr, const HeteroContainer<M> &cont)
 {
-	outStr << cont.count << "\n";
-	typename HeteroContainer<M>::Node *crr = cont.first;
-	while (crr != nullptr)
+	outStr << cont.entries.size() << "\n";
+	for (const typename HeteroContainer<M>::Entry &entry : cont.entries)
 	{
-		outStr << crr->type << " " << crr->container->size() << " ";
-		BaseIterator<M> *it = crr->container->begin(false); //False because we do NOT use the regular iterator but the serialization one(for the tree)
-		BaseIterator<M> *end = crr->container->end();
+		outStr << entry.type << " " << entry.container->size() << " ";
+		BaseIterator<M> *it = entry.container->begin(false); //False because we do NOT use the regular iterator but the serialization one(for the tree)
+		BaseIterator<M> *end = entry.container->end();
 		while (!it->are_equal(end))
 		{
 			outStr << it->value() << " ";
@@ -461,10 +1451,8 @@ inline std::ostream & operator<<(std::ostream &outStr, const HeteroContainer<M>
 		delete it;
 		delete end;
 		outStr << "\n";
-
-		crr = crr->next;
 	}
-	outStr << "Where the first number in each line is as follows: 0 - STACK, 1 - QUEUE, 2 - LINKED_LIST, 3 - BIN_SEARCH_TREE." <<
+	outStr << "Where the first number in each line is as follows: 0 - STACK, 1 - QUEUE, 2 - LINKED_LIST, 3 - BIN_SEARCH_TREE, 4 - BALANCED_BIN_SEARCH_TREE." <<
 		" The second number in each line is the amount of elements in the current subContainer.";
 
 	return outStr;
@@ -473,59 +1461,57 @@ inline std::ostream & operator<<(std::ostream &outStr, const HeteroContainer<M>
 template<typename M>
 inline std::istream & operator>>(std::istream &inStr, HeteroContainer<M> &cont)
 {
+	//on malformed input (or a stream that failed before) the container stays unchanged
 	size_t amount;
-	inStr >> amount;
+	if (!(inStr >> amount)) return inStr;
 
 	HeteroContainer<M> result;
 	for (size_t ind = 0; ind < amount; ind++)
 	{
 		short type;
-		inStr >> type;
+		if (!(inStr >> type)) return inStr;
+		if (type < HeteroContainer<M>::STACK || type > HeteroContainer<M>::BALANCED_BIN_SEARCH_TREE)
+		{
+			inStr.setstate(std::ios::failbit);
+			return inStr;
+		}
 		result.add_container((typename HeteroContainer<M>::Type)type);
 		
 		size_t elementsAmount;
-		inStr >> elementsAmount;
+		if (!(inStr >> elementsAmount)) return inStr;
 		for (size_t innerInd = 0; innerInd < elementsAmount; innerInd++)
 		{
 			M value;
-			inStr >> value;
-			result.last->container->push(value);
+			if (!(inStr >> value)) return inStr;
+			result.entries.back().container->push(std::move(value));
 		}
 	}
+	result.rebuild_sizes();
 
-	//move semantics
-	//result is temporary, so we serialize inside it and just steal all it's data => 
-	//destructor will delete the old container content at the and of the function
-	std::swap(cont.first, result.first);
-	std::swap(cont.last, result.last);
-	std::swap(cont.count, result.count);
+	//the old content of the container is destroyed together with result
+	cont = std::move(result);
 
 	return inStr;
 }
 
 template<typename T>
-inline HeteroContainer<T>::SpecificIterator::SpecificIterator(Node *start, bool isEnd, bool inDepth)
-	: ind(0), first(start), inDepth(inDepth), processedElements(0)
+inline HeteroContainer<T>::SpecificIterator::SpecificIterator(const HeteroContainer<T> *owner, bool isEnd, bool inDepth)
+	: owner(owner), ind(0), processedElements(0), inDepth(inDepth)
 {
-	Node *crr = start;
-	size_t count = 0;
-	size_t indCount = 0;
-	while (crr != nullptr)
+	if (isEnd)
 	{
-		if (!isEnd) iterators.push_back(crr->container->begin(false));
-		count += crr->container->size();
-		++indCount;
-		if (!isEnd) ends.push_back(crr->container->end());
-
-		crr = crr->next;
+		processedElements = owner->count;
+		ind = (int)owner->entries.size();
+		return;
 	}
 
-	if (isEnd)
+	for (const Entry &entry : owner->entries)
 	{
-		processedElements = count;
-		ind = indCount;
+		iterators.push_back(entry.container->begin(false));
+		ends.push_back(entry.container->end());
 	}
-	else if (inDepth) 
+
+	if (inDepth) 
 	{
 		wind_depth();
 	}
@@ -547,7 +1533,7 @@ inline HeteroContainer<T>::SpecificIterator::SpecificIterator(const SpecificIter
 
 	processedElements = other.processedElements;
 	ind = other.ind;
-	first = other.first;
+	owner = other.owner;
 	inDepth = other.inDepth;
 }
 
@@ -556,7 +1542,7 @@ inline typename HeteroContainer<T>::SpecificIterator & HeteroContainer<T>::Speci
 {
 	std::swap(ind, other.ind);
 	std::swap(processedElements, other.processedElements);
-	std::swap(first, other.first);
+	std::swap(owner, other.owner);
 	std::swap(iterators, other.iterators);
 	std::swap(ends, other.ends);
 
@@ -573,15 +1559,15 @@ inline typename HeteroContainer<T>::SpecificIterator & HeteroContainer<T>::Speci
 }
 
 template<typename T>
-inline T HeteroContainer<T>::SpecificIterator::operator*() const
+inline const T& HeteroContainer<T>::SpecificIterator::operator*() const
 {
 	return iterators[ind]->value();
 }
 
 template<typename T>
-inline bool HeteroContainer<T>::SpecificIterator::operator!=(SpecificIterator &other) const
+inline bool HeteroContainer<T>::SpecificIterator::operator!=(const SpecificIterator &other) const
 {
-	return first != other.first || inDepth != other.inDepth || 
+	return owner != other.owner || inDepth != other.inDepth || 
 		ind != other.ind || processedElements != other.processedElements;
 }
 
@@ -600,18 +1586,18 @@ inline void HeteroContainer<T>::SpecificIterator::wind_depth()
 {
 	if (iterators[ind]->are_equal(ends[ind])) ++ind;
 
-	if (ind < iterators.size()) ++processedElements;
+	if (ind < (int)iterators.size()) ++processedElements;
 }
 
 template<typename T>
 inline void HeteroContainer<T>::SpecificIterator::wind_breadth()
 {
 	++ind;
-	if (ind >= iterators.size()) ind = 0;
-	while (ind < iterators.size() && iterators[ind]->are_equal(ends[ind]))
+	if (ind >= (int)iterators.size()) ind = 0;
+	while (ind < (int)iterators.size() && iterators[ind]->are_equal(ends[ind]))
 	{
 		++ind;
 	}
 
-	if (ind != iterators.size()) ++processedElements;
+	if (ind != (int)iterators.size()) ++processedElements;
 }
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <vector>
+
+//Optional profiling layer, compiled in only when HETERO_INSTRUMENTATION is defined; otherwise the HETERO_*
+//macros below expand to nothing and the containers carry no extra state.
+//
+//Every container counts the operations called on it. An operation makes its container the current one for
+//the calling thread, so the work done inside it - comparisons, predicate calls, node allocations, also those
+//of a container used as storage - is charged to it. The counters and the histograms are not synchronized:
+//operations that run concurrently on the same container (const ones included) race on them.
+namespace Instrumentation
+{
+	struct Counters
+	{
+		uint64_t pushes = 0;
+		uint64_t pops = 0;
+		uint64_t containsProbes = 0;
+		uint64_t predicateEvaluations = 0;
+		uint64_t comparisons = 0;
+		uint64_t nodeAllocations = 0;
+	};
+
+	//the counters of the container whose operation is running on this thread
+	inline Counters*& current()
+	{
+		static thread_local Counters *counters = nullptr;
+		return counters;
+	}
+
+	inline void count(uint64_t Counters::*counter, uint64_t amount = 1)
+	{
+		if (current() != nullptr) current()->*counter += amount;
+	}
+
+	//Makes the counters current for its lifetime and counts the operation; inside an operation that is already
+	//running (a container forwarding to its storage) it does nothing, so every call is counted once
+	class Scope
+	{
+	public:
+		Scope(Counters &counters, uint64_t Counters::*operation = nullptr, uint64_t amount = 1)
+			: installed(current() == nullptr)
+		{
+			if (!installed) return;
+
+			current() = &counters;
+			if (operation != nullptr) counters.*operation += amount;
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		~Scope()
+		{
+			if (installed) current() = nullptr;
+		}
+
+	private:
+		bool installed;
+	};
+
+	//Latency histogram in nanoseconds with HDR-style buckets: every power of two is split into SUB_BUCKETS
+	//linear buckets, so any recorded value is reported with a relative error below 1 / SUB_BUCKETS while
+	//the whole 64 bit range takes less than a thousand buckets
+	class Histogram
+	{
+	public:
+		static const unsigned SUB_BUCKET_BITS = 4;
+		static const uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+		Histogram()
+			: total(0), sum(0), minimum(0), maximum(0)
+		{}
+
+		void record(uint64_t value)
+		{
+			size_t bucket = bucket_of(value);
+			if (bucket >= buckets.size()) buckets.resize(bucket + 1, 0);
+			++buckets[bucket];
+
+			minimum = total == 0 || value < minimum ? value : minimum;
+			maximum = value > maximum ? value : maximum;
+			sum += value;
+			++total;
+		}
+
+		void merge(const Histogram &other)
+		{
+			if (other.total == 0) return;
+			if (other.buckets.size() > buckets.size()) buckets.resize(other.buckets.size(), 0);
+			for (size_t ind = 0; ind < other.buckets.size(); ind++) buckets[ind] += other.buckets[ind];
+
+			minimum = total == 0 || other.minimum < minimum ? other.minimum : minimum;
+			maximum = other.maximum > maximum ? other.maximum : maximum;
+			sum += other.sum;
+			total += other.total;
+		}
+
+		void reset()
+		{
+			*this = Histogram();
+		}
+
+		uint64_t count() const { return total; }
+		uint64_t min() const { return minimum; }
+		uint64_t max() const { return maximum; }
+		double mean() const { return total == 0 ? 0 : (double)sum / total; }
+
+		//the highest value equivalent to the one below which percent of the recorded values are; 0 when empty
+		uint64_t percentile(double percent) const
+		{
+			if (total == 0) return 0;
+
+			uint64_t rank = (uint64_t)(percent / 100 * total + 0.5);
+			rank = rank == 0 ? 1 : (rank > total ? total : rank);
+
+			uint64_t seen = 0;
+			for (size_t ind = 0; ind < buckets.size(); ind++)
+			{
+				seen += buckets[ind];
+				if (seen >= rank) return highest_of(ind) < maximum ? highest_of(ind) : maximum;
+			}
+
+			return maximum;
+		}
+
+		//visitor(lowest, highest, count) for every non empty bucket in ascending order - for exporting
+		template <typename Visitor>
+		void for_each_bucket(Visitor visitor) const
+		{
+			for (size_t ind = 0; ind < buckets.size(); ind++)
+			{
+				if (buckets[ind] != 0) visitor(lowest_of(ind), highest_of(ind), buckets[ind]);
+			}
+		}
+
+	private:
+		static size_t bucket_of(uint64_t value)
+		{
+			if (value < SUB_BUCKETS) return (size_t)value;
+
+			unsigned exponent = SUB_BUCKET_BITS;
+			while (exponent < 63 && (value >> (exponent + 1)) != 0) ++exponent;
+
+			unsigned shift = exponent - SUB_BUCKET_BITS;
+			return (size_t)(((shift + 1) << SUB_BUCKET_BITS) + ((value >> shift) & (SUB_BUCKETS - 1)));
+		}
+
+		static uint64_t lowest_of(size_t bucket)
+		{
+			if (bucket < SUB_BUCKETS) return bucket;
+
+			unsigned shift = (unsigned)(bucket >> SUB_BUCKET_BITS) - 1;
+			return (SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1))) << shift;
+		}
+
+		static uint64_t highest_of(size_t bucket)
+		{
+			if (bucket < SUB_BUCKETS) return bucket;
+
+			unsigned shift = (unsigned)(bucket >> SUB_BUCKET_BITS) - 1;
+			return lowest_of(bucket) + ((uint64_t(1) << shift) - 1);
+		}
+
+		std::vector<uint64_t> buckets;
+		uint64_t total;
+		uint64_t sum;
+		uint64_t minimum;
+		uint64_t maximum;
+	};
+
+	//records the nanoseconds of its lifetime into the histogram
+	class Timer
+	{
+	public:
+		Timer(Histogram &histogram)
+			: histogram(histogram), start(std::chrono::steady_clock::now())
+		{}
+
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+
+		~Timer()
+		{
+			histogram.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+
+	private:
+		Histogram &histogram;
+		std::chrono::steady_clock::time_point start;
+	};
+}
+
+#ifdef HETERO_INSTRUMENTATION
+//inside a member of a BaseContainer: counts the operation (amount times) and charges the work inside to the container
+#define HETERO_OPERATION(counter) Instrumentation::Scope heteroScope(this->operationCounters, &Instrumentation::Counters::counter)
+#define HETERO_OPERATION_N(counter, amount) Instrumentation::Scope heteroScope(this->operationCounters, &Instrumentation::Counters::counter, amount)
+#define HETERO_SCOPE() Instrumentation::Scope heteroScope(this->operationCounters)
+//charges work to the container whose operation is running
+#define HETERO_COUNT(counter) Instrumentation::count(&Instrumentation::Counters::counter)
+#define HETERO_TIME(histogram) Instrumentation::Timer heteroTimer(histogram)
+#else
+#define HETERO_OPERATION(counter)
+#define HETERO_OPERATION_N(counter, amount)
+#define HETERO_SCOPE()
+#define HETERO_COUNT(counter)
+#define HETERO_TIME(histogram)
+#endif
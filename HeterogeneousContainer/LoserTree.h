@@ -0,0 +1,124 @@
+#pragma once
+
+#include <assert.h>
+#include <vector>
+
+//Tournament tree for k-way merging. Every leaf caches the head value of one sequence, so
+//replacing the winner costs O(log k) comparisons and no sequence is asked for a value twice.
+//The heads are kept by address, so they are never copied and have to stay in place until the leaf is set again.
+//Ties are resolved in favour of the leaf with the smaller index.
+template <typename T>
+class LoserTree
+{
+public:
+	LoserTree(size_t = 0);
+
+	void set(size_t, const T&); //stores the new head of a leaf
+	void exhaust(size_t); //marks a leaf as finished; it loses against everything
+	void build();
+	void replay(size_t); //restores the tree after the head of the given leaf has changed
+
+	int winner() const; //-1 when every leaf is exhausted
+	const T& top() const;
+	size_t leaves() const;
+
+private:
+	bool beats(size_t, size_t) const;
+
+	std::vector<const T*> heads;
+	std::vector<bool> exhausted;
+	std::vector<size_t> losers; //losers[0] holds the overall winner, losers[1..k) the internal nodes
+};
+
+template<typename T>
+inline LoserTree<T>::LoserTree(size_t leavesCount)
+	: heads(leavesCount, nullptr), exhausted(leavesCount, true), losers(leavesCount, 0)
+{}
+
+template<typename T>
+inline void LoserTree<T>::set(size_t leaf, const T &value)
+{
+	heads[leaf] = &value;
+	exhausted[leaf] = false;
+}
+
+template<typename T>
+inline void LoserTree<T>::exhaust(size_t leaf)
+{
+	exhausted[leaf] = true;
+}
+
+template<typename T>
+inline void LoserTree<T>::build()
+{
+	size_t count = heads.size();
+	if (count == 0) return;
+
+	//winners of the subtrees; leaf i lives at position count + i
+	std::vector<size_t> winners(2 * count);
+	for (size_t ind = 0; ind < count; ind++) winners[count + ind] = ind;
+
+	for (size_t node = count - 1; node > 0; node--)
+	{
+		size_t left = winners[2 * node];
+		size_t right = winners[2 * node + 1];
+
+		if (beats(right, left))
+		{
+			winners[node] = right;
+			losers[node] = left;
+		}
+		else
+		{
+			winners[node] = left;
+			losers[node] = right;
+		}
+	}
+
+	losers[0] = count == 1 ? 0 : winners[1];
+}
+
+template<typename T>
+inline void LoserTree<T>::replay(size_t leaf)
+{
+	size_t crr = leaf;
+	for (size_t node = (leaf + heads.size()) / 2; node > 0; node /= 2)
+	{
+		if (beats(losers[node], crr)) std::swap(losers[node], crr);
+	}
+
+	losers[0] = crr;
+}
+
+template<typename T>
+inline int LoserTree<T>::winner() const
+{
+	if (heads.empty() || exhausted[losers[0]]) return -1;
+
+	return (int)losers[0];
+}
+
+template<typename T>
+inline const T & LoserTree<T>::top() const
+{
+	assert(winner() != -1);
+
+	return *heads[losers[0]];
+}
+
+template<typename T>
+inline size_t LoserTree<T>::leaves() const
+{
+	return heads.size();
+}
+
+template<typename T>
+inline bool LoserTree<T>::beats(size_t first, size_t second) const
+{
+	if (exhausted[first]) return false;
+	if (exhausted[second]) return true;
+	if (*heads[first] < *heads[second]) return true;
+	if (*heads[second] < *heads[first]) return false;
+
+	return first < second;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Read only memory mapping of a whole file. The pages are loaded by the OS on first access,
+//so opening even a huge file costs only a few system calls.
+class MappedFile
+{
+public:
+	MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const char*);
+	void close();
+
+	const char* data() const;
+	size_t size() const;
+
+	~MappedFile();
+
+private:
+	const char *bytes;
+	size_t length;
+};
+
+inline MappedFile::MappedFile()
+	: bytes(nullptr), length(0)
+{}
+
+inline bool MappedFile::open(const char *fileName)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	CloseHandle(file);
+	if (mapping == nullptr) return false;
+
+	bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	CloseHandle(mapping); //the view keeps the mapping alive
+	if (bytes == nullptr) return false;
+
+	length = (size_t)fileSize.QuadPart;
+#else
+	int file = ::open(fileName, O_RDONLY);
+	if (file == -1) return false;
+
+	struct stat info;
+	void *view = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	::close(file); //the mapping stays valid after the descriptor is closed
+	if (view == MAP_FAILED) return false;
+
+	bytes = static_cast<const char*>(view);
+	length = (size_t)info.st_size;
+#endif
+
+	return true;
+}
+
+inline void MappedFile::close()
+{
+	if (bytes == nullptr) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(bytes);
+#else
+	munmap(const_cast<char*>(bytes), length);
+#endif
+
+	bytes = nullptr;
+	length = 0;
+}
+
+inline const char * MappedFile::data() const
+{
+	return bytes;
+}
+
+inline size_t MappedFile::size() const
+{
+	return length;
+}
+
+inline MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,346 @@
+#pragma once
+
+#include "BaseContainer.h"
+#include "MappedFile.h"
+#include <assert.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//Read only subcontainer over the raw payload of a memory mapped binary snapshot. It answers size, lookups, seeks
+//and iteration straight from the mapped bytes, so reading it never writes to it; the first operation that modifies
+//it pushes the payload into a regular container, releases the mapping and from then on forwards every call.
+template <typename T>
+class MappedView : public BaseContainer<T>
+{
+public:
+	//target is the empty container of the subcontainer type; reversed is set for the types that load by
+	//pushing to the front, so their iteration order is the payload order reversed; the payload of a tree
+	//is in ascending order, so it is searched directly and serialized as the pre-order of a balanced tree
+	MappedView(std::shared_ptr<const MappedFile>, const T*, size_t, BaseContainer<T> *target, bool reversed, bool tree);
+	MappedView(const MappedView<T>&);
+	MappedView<T>& operator=(const MappedView<T>&) = delete;
+
+	virtual bool contains(const T&) const override;
+	virtual bool contains(PredicateRef<T>) const override;
+	virtual void filter(PredicateRef<T>) override;
+	virtual void sort() override;
+	virtual void push(const T&) override;
+	virtual void push(T&&) override;
+	virtual T pop() override;
+	virtual void push_range(const T*, size_t) override;
+	virtual size_t size() const override;
+	virtual short id() const override;
+	virtual bool empty() const override;
+	virtual BaseContainer<T>* clone() const override;
+	virtual MemoryUsage memory_usage() const override; //the mapped elements count as payload until materialized
+
+	virtual BaseIterator<T>* begin(bool = true) const override;
+	virtual BaseIterator<T>* end() const override;
+	virtual BaseIterator<T>* lower_bound(const T&, size_t&) const override;
+	virtual BaseIterator<T>* upper_bound(const T&, size_t&) const override;
+
+	bool is_materialized() const;
+
+	virtual ~MappedView() override;
+
+private:
+	BaseContainer<T>* materialize();
+
+	std::shared_ptr<const MappedFile> file; //released once the target holds the elements
+	const T *elements;
+	size_t count;
+	BaseContainer<T> *target;
+	bool materialized;
+	bool reversed;
+	bool tree;
+};
+
+template <typename T>
+class MappedIterator : public BaseIterator<T>
+{
+public:
+	MappedIterator(const T*, size_t, size_t, bool);
+
+	virtual void next() override;
+	virtual const T& value() const override;
+	virtual bool are_equal(BaseIterator<T>*) const override; //by position, so it compares with the pre-order iterator too
+	virtual BaseIterator<T>* clone() const override;
+
+protected:
+	const T *elements;
+	size_t count;
+	size_t position; //the amount of elements passed
+	bool reversed;
+};
+
+//Walks an ascending payload as the pre-order of the balanced tree whose root is the middle element,
+//so pushing the elements in this order into an empty tree builds it balanced
+template <typename T>
+class MappedPreOrderIterator : public MappedIterator<T>
+{
+public:
+	MappedPreOrderIterator(const T*, size_t);
+
+	virtual void next() override;
+	virtual const T& value() const override;
+	virtual BaseIterator<T>* clone() const override;
+
+private:
+	void descend();
+
+	std::vector<std::pair<size_t, size_t>> pending; //the subtrees still to walk as [from, to) ranges of the payload
+	size_t crr;
+};
+
+template<typename T>
+inline MappedView<T>::MappedView(std::shared_ptr<const MappedFile> file, const T *elements, size_t count, BaseContainer<T> *target, bool reversed, bool tree)
+	: file(file), elements(elements), count(count), target(target), materialized(false), reversed(reversed), tree(tree)
+{}
+
+template<typename T>
+inline MappedView<T>::MappedView(const MappedView<T> &other)
+	: file(other.file), elements(other.elements), count(other.count), target(other.target->clone()),
+	materialized(other.materialized), reversed(other.reversed), tree(other.tree)
+{}
+
+template<typename T>
+inline bool MappedView<T>::contains(const T &element) const
+{
+	HETERO_OPERATION(containsProbes);
+	if (materialized) return target->contains(element);
+	if (tree) return std::binary_search(elements, elements + count, element, [](const T &left, const T &right) { HETERO_COUNT(comparisons); return left < right; });
+
+	return std::find_if(elements, elements + count, [&element](const T &crr) { HETERO_COUNT(comparisons); return crr == element; }) != elements + count;
+}
+
+template<typename T>
+inline bool MappedView<T>::contains(PredicateRef<T> pred) const
+{
+	HETERO_OPERATION(containsProbes);
+	if (materialized) return target->contains(pred);
+
+	return std::find_if(elements, elements + count, [&pred](const T &crr) { HETERO_COUNT(predicateEvaluations); return pred(crr); }) != elements + count;
+}
+
+template<typename T>
+inline void MappedView<T>::filter(PredicateRef<T> pred)
+{
+	HETERO_SCOPE();
+	materialize()->filter(pred);
+}
+
+template<typename T>
+inline void MappedView<T>::sort()
+{
+	HETERO_SCOPE();
+	materialize()->sort();
+}
+
+template<typename T>
+inline void MappedView<T>::push(const T &element)
+{
+	HETERO_OPERATION(pushes);
+	materialize()->push(element);
+}
+
+template<typename T>
+inline void MappedView<T>::push(T &&element)
+{
+	HETERO_OPERATION(pushes);
+	materialize()->push(std::move(element));
+}
+
+template<typename T>
+inline T MappedView<T>::pop()
+{
+	HETERO_OPERATION(pops);
+	return materialize()->pop();
+}
+
+template<typename T>
+inline void MappedView<T>::push_range(const T *first, size_t amount)
+{
+	HETERO_OPERATION_N(pushes, amount);
+	materialize()->push_range(first, amount);
+}
+
+template<typename T>
+inline size_t MappedView<T>::size() const
+{
+	return materialized ? target->size() : count;
+}
+
+template<typename T>
+inline short MappedView<T>::id() const
+{
+	return target->id();
+}
+
+template<typename T>
+inline bool MappedView<T>::empty() const
+{
+	return size() == 0;
+}
+
+template<typename T>
+inline BaseContainer<T>* MappedView<T>::clone() const
+{
+	//an untouched view is copied by sharing the mapping
+	return new MappedView<T>(*this);
+}
+
+template<typename T>
+inline MemoryUsage MappedView<T>::memory_usage() const
+{
+	MemoryUsage usage = target->memory_usage();
+	if (!materialized) usage.payload += count * sizeof(T);
+	usage.overhead += sizeof(*this);
+
+	return usage;
+}
+
+template<typename T>
+inline BaseIterator<T>* MappedView<T>::begin(bool useRegular) const
+{
+	if (materialized) return target->begin(useRegular);
+	if (tree && !useRegular) return new MappedPreOrderIterator<T>(elements, count);
+
+	return new MappedIterator<T>(elements, count, 0, reversed);
+}
+
+template<typename T>
+inline BaseIterator<T>* MappedView<T>::end() const
+{
+	if (materialized) return target->end();
+
+	return new MappedIterator<T>(elements, count, count, reversed);
+}
+
+template<typename T>
+inline BaseIterator<T>* MappedView<T>::lower_bound(const T &element, size_t &skipped) const
+{
+	HETERO_SCOPE();
+	if (materialized) return target->lower_bound(element, skipped);
+	if (!tree) return BaseContainer<T>::lower_bound(element, skipped);
+
+	auto less = [](const T &left, const T &right) { HETERO_COUNT(comparisons); return left < right; };
+	skipped = std::lower_bound(elements, elements + count, element, less) - elements;
+
+	return new MappedIterator<T>(elements, count, skipped, false);
+}
+
+template<typename T>
+inline BaseIterator<T>* MappedView<T>::upper_bound(const T &element, size_t &skipped) const
+{
+	HETERO_SCOPE();
+	if (materialized) return target->upper_bound(element, skipped);
+	if (!tree) return BaseContainer<T>::upper_bound(element, skipped);
+
+	auto less = [](const T &left, const T &right) { HETERO_COUNT(comparisons); return left < right; };
+	skipped = std::upper_bound(elements, elements + count, element, less) - elements;
+
+	return new MappedIterator<T>(elements, count, skipped, false);
+}
+
+template<typename T>
+inline bool MappedView<T>::is_materialized() const
+{
+	return materialized;
+}
+
+template<typename T>
+inline MappedView<T>::~MappedView()
+{
+	delete target;
+}
+
+template<typename T>
+inline BaseContainer<T>* MappedView<T>::materialize()
+{
+	if (!materialized)
+	{
+		//the same way a regular load pushes the elements
+		if (tree) target->push_range(elements, count);
+		else
+		{
+			for (size_t ind = 0; ind < count; ind++) target->push(elements[ind]);
+		}
+		materialized = true;
+
+		elements = nullptr;
+		file.reset();
+	}
+
+	return target;
+}
+
+template<typename T>
+inline MappedIterator<T>::MappedIterator(const T *elements, size_t count, size_t position, bool reversed)
+	: elements(elements), count(count), position(position), reversed(reversed)
+{}
+
+template<typename T>
+inline void MappedIterator<T>::next()
+{
+	++position;
+}
+
+template<typename T>
+inline const T& MappedIterator<T>::value() const
+{
+	return elements[reversed ? count - 1 - position : position];
+}
+
+template<typename T>
+inline bool MappedIterator<T>::are_equal(BaseIterator<T> *other) const
+{
+	return ((MappedIterator<T>*)other)->position == position;
+}
+
+template<typename T>
+inline BaseIterator<T>* MappedIterator<T>::clone() const
+{
+	return new MappedIterator<T>(*this);
+}
+
+template<typename T>
+inline MappedPreOrderIterator<T>::MappedPreOrderIterator(const T *elements, size_t count)
+	: MappedIterator<T>(elements, count, 0, false), crr(0)
+{
+	if (count == 0) return;
+
+	pending.push_back(std::make_pair((size_t)0, count));
+	descend();
+}
+
+template<typename T>
+inline void MappedPreOrderIterator<T>::next()
+{
+	++this->position;
+	if (!pending.empty()) descend();
+}
+
+template<typename T>
+inline const T& MappedPreOrderIterator<T>::value() const
+{
+	return this->elements[crr];
+}
+
+template<typename T>
+inline BaseIterator<T>* MappedPreOrderIterator<T>::clone() const
+{
+	return new MappedPreOrderIterator<T>(*this);
+}
+
+template<typename T>
+inline void MappedPreOrderIterator<T>::descend()
+{
+	//the root of the next subtree is its middle element; its left subtree is walked before its right one
+	std::pair<size_t, size_t> range = pending.back();
+	pending.pop_back();
+	crr = range.first + (range.second - range.first) / 2;
+	if (crr + 1 < range.second) pending.push_back(std::make_pair(crr + 1, range.second));
+	if (range.first < crr) pending.push_back(std::make_pair(range.first, crr));
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+//Node allocators used by the linked containers. An allocator hands out raw memory for one node at a time:
+//	void* allocate();
+//	void deallocate(N*); - the node is already destroyed
+//	void release(); - frees everything at once; every node must already be destroyed or trivially destructible
+//	void swap(Allocator<N>&);
+//	size_t reserved(size_t used) const; - bytes taken from the system while used nodes are allocated, in O(1)
+//	static const bool bulkRelease; - true when release() returns the memory of nodes that were never deallocated
+
+//Slab allocator owned by a single container. Released nodes go to a free list and are reused by the next
+//allocation, the slabs themselves are returned to the system only by release() or the destructor.
+template <typename N>
+class NodePool
+{
+public:
+	static const bool bulkRelease = true;
+
+	NodePool();
+	NodePool(const NodePool<N>&); //the copy of a container gets a new empty pool
+	NodePool<N>& operator=(const NodePool<N>&) = delete;
+
+	void* allocate();
+	void deallocate(N*);
+	void release();
+	void swap(NodePool<N>&);
+	size_t reserved(size_t) const;
+
+	~NodePool();
+
+private:
+	union Slot
+	{
+		Slot *next;
+		typename std::aligned_storage<sizeof(N), alignof(N)>::type storage;
+	};
+
+	static const size_t FIRST_SLAB_SIZE = 16;
+	static const size_t MAX_SLAB_SIZE = 4096;
+
+	std::vector<Slot*> slabs;
+	Slot *freeList;
+	size_t used; //slots handed out from the newest slab
+	size_t capacity; //slots in the newest slab
+	size_t slots; //slots in all slabs
+};
+
+//Plain new/delete for every node - no recycling and no bulk release
+template <typename N>
+class HeapAllocator
+{
+public:
+	static const bool bulkRelease = false;
+
+	void* allocate();
+	void deallocate(N*);
+	void release();
+	void swap(HeapAllocator<N>&);
+	size_t reserved(size_t) const;
+};
+
+template<typename N>
+inline NodePool<N>::NodePool()
+	: freeList(nullptr), used(0), capacity(0), slots(0)
+{}
+
+template<typename N>
+inline NodePool<N>::NodePool(const NodePool<N>&)
+	: NodePool()
+{}
+
+template<typename N>
+inline void * NodePool<N>::allocate()
+{
+	if (freeList != nullptr)
+	{
+		Slot *slot = freeList;
+		freeList = freeList->next;
+
+		return slot;
+	}
+
+	if (used == capacity)
+	{
+		capacity = slabs.empty() ? FIRST_SLAB_SIZE : (capacity * 2 < MAX_SLAB_SIZE ? capacity * 2 : MAX_SLAB_SIZE);
+		slabs.push_back(static_cast<Slot*>(::operator new(capacity * sizeof(Slot))));
+		slots += capacity;
+		used = 0;
+	}
+
+	return slabs.back() + used++;
+}
+
+template<typename N>
+inline void NodePool<N>::deallocate(N *node)
+{
+	Slot *slot = reinterpret_cast<Slot*>(node);
+	slot->next = freeList;
+	freeList = slot;
+}
+
+template<typename N>
+inline void NodePool<N>::release()
+{
+	for (Slot *slab : slabs) ::operator delete(slab);
+
+	slabs.clear();
+	freeList = nullptr;
+	used = 0;
+	capacity = 0;
+	slots = 0;
+}
+
+template<typename N>
+inline void NodePool<N>::swap(NodePool<N> &other)
+{
+	std::swap(slabs, other.slabs);
+	std::swap(freeList, other.freeList);
+	std::swap(used, other.used);
+	std::swap(capacity, other.capacity);
+	std::swap(slots, other.slots);
+}
+
+template<typename N>
+inline size_t NodePool<N>::reserved(size_t) const
+{
+	return slots * sizeof(Slot);
+}
+
+template<typename N>
+inline NodePool<N>::~NodePool()
+{
+	release();
+}
+
+template<typename N>
+inline void * HeapAllocator<N>::allocate()
+{
+	return ::operator new(sizeof(N));
+}
+
+template<typename N>
+inline void HeapAllocator<N>::deallocate(N *node)
+{
+	::operator delete(node);
+}
+
+template<typename N>
+inline void HeapAllocator<N>::release()
+{}
+
+template<typename N>
+inline void HeapAllocator<N>::swap(HeapAllocator<N>&)
+{}
+
+template<typename N>
+inline size_t HeapAllocator<N>::reserved(size_t used) const
+{
+	return used * sizeof(N); //the bookkeeping of the system allocator is not known
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//Runs task(ind) for every ind in [0, count) on up to threadsCount threads, the calling thread included.
+//The indexes are handed out one at a time from a shared counter, so a thread that is done with a cheap
+//task immediately takes over the next pending one instead of waiting for the threads with expensive tasks.
+template <typename Task>
+void parallel_for(size_t count, size_t threadsCount, Task task)
+{
+	std::atomic<size_t> nextIndex(0);
+	auto worker = [&nextIndex, &task, count]()
+	{
+		for (size_t ind = nextIndex++; ind < count; ind = nextIndex++) task(ind);
+	};
+
+	if (threadsCount > count) threadsCount = count;
+
+	std::vector<std::thread> threads;
+	for (size_t ind = 1; ind < threadsCount; ind++) threads.emplace_back(worker);
+
+	worker();
+	for (std::thread &thread : threads) thread.join();
+}
+
+//Returns whether test(ind, stop) holds for some ind in [0, count). Once a thread finds a match the indexes
+//that are not started yet are skipped, and stop is set so the tests that are running can give up early;
+//what a test returns after stop was set does not matter.
+template <typename Test>
+bool parallel_any(size_t count, size_t threadsCount, Test test)
+{
+	std::atomic<bool> found(false);
+	parallel_for(count, threadsCount, [&found, &test](size_t ind)
+	{
+		if (!found.load(std::memory_order_relaxed) && test(ind, (const std::atomic<bool>&)found)) found = true;
+	});
+
+	return found;
+}
@@ -2,114 +2,222 @@
 
 #include "BaseContainer.h"
 #include "DoublyLinkedList.h"
+#include "RingBuffer.h"
 #include <assert.h>
 #include <algorithm>
 
-template <typename T>
+//Storage keeps the elements - a contiguous RingBuffer by default; DoublyLinkedList<T> (with any node allocator) fits as well
+template <typename T, typename Storage = RingBuffer<T>>
 class Queue : public BaseContainer<T>
 {
 public:
 	Queue();
 
 	virtual bool contains(const T&) const override;
-	virtual bool contains(Condition<T>) const override;
-	virtual void filter(Condition<T>);
+	virtual bool contains(PredicateRef<T>) const override;
+	virtual void filter(PredicateRef<T>) override;
 	virtual void sort();
 	virtual void push(const T&) override;
+	virtual void push(T&&) override;
 	virtual T pop() override;
+	virtual void push_range(const T*, size_t) override;
 	virtual size_t size() const override;
 	virtual short id() const override;
 	virtual bool empty() const override;
 	virtual BaseContainer<T>* clone() const override;
+	virtual MemoryUsage memory_usage() const override;
 
 	virtual BaseIterator<T>* begin(bool = true) const;
 	virtual BaseIterator<T>* end() const;
+	virtual BaseIterator<T>* lower_bound(const T&, size_t&) const override;
+	virtual BaseIterator<T>* upper_bound(const T&, size_t&) const override;
 
-	bool operator==(const Queue<T>&) const;
+	//iterators of the storage held by value, so their calls are resolved at compile time
+	typedef typename Storage::Iterator Iterator;
+	Iterator cbegin() const;
+	Iterator cend() const;
+
+	//the same as the virtual overloads with the predicate inlined into the scan of the storage
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	void filter(Predicate);
+
+	template <typename... Args>
+	void emplace(Args&&...); //builds the element in place in the storage
+
+	bool operator==(const Queue<T, Storage>&) const;
+	const Storage& storage() const; //read only access for the searches that need positions
 
 private:
-	DoublyLinkedList<T> elements;
+	Storage elements;
 };
 
-template<typename T>
-inline Queue<T>::Queue()
+template<typename T, typename Storage>
+inline Queue<T, Storage>::Queue()
 {}
 
-template<typename T>
-inline bool Queue<T>::contains(const T &element) const
+template<typename T, typename Storage>
+inline bool Queue<T, Storage>::contains(const T &element) const
 {
+	HETERO_OPERATION(containsProbes);
 	return elements.contains(element);
 }
 
-template<typename T>
-inline bool Queue<T>::contains(Condition<T> pred) const
+template<typename T, typename Storage>
+inline bool Queue<T, Storage>::contains(PredicateRef<T> pred) const
+{
+	HETERO_OPERATION(containsProbes);
+	return elements.contains(pred);
+}
+
+template<typename T, typename Storage>
+inline void Queue<T, Storage>::filter(PredicateRef<T> predicate)
+{
+	HETERO_SCOPE();
+	elements.filter(predicate);
+}
+
+template<typename T, typename Storage>
+template<typename Predicate, typename>
+inline bool Queue<T, Storage>::contains(Predicate pred) const
 {
+	HETERO_OPERATION(containsProbes);
 	return elements.contains(pred);
 }
 
-template<typename T>
-inline void Queue<T>::filter(Condition<T> predicate)
+template<typename T, typename Storage>
+template<typename Predicate, typename>
+inline void Queue<T, Storage>::filter(Predicate predicate)
 {
+	HETERO_SCOPE();
 	elements.filter(predicate);
 }
 
-template<typename T>
-inline void Queue<T>::sort()
+template<typename T, typename Storage>
+inline void Queue<T, Storage>::sort()
 {
+	HETERO_SCOPE();
 	elements.sort();
 }
 
-template<typename T>
-inline void Queue<T>::push(const T &element)
+template<typename T, typename Storage>
+inline void Queue<T, Storage>::push(const T &element)
 {
+	HETERO_OPERATION(pushes);
 	elements.push_back(element);
 }
 
-template<typename T>
-inline T Queue<T>::pop()
+template<typename T, typename Storage>
+inline void Queue<T, Storage>::push(T &&element)
+{
+	HETERO_OPERATION(pushes);
+	elements.push_back(std::move(element));
+}
+
+template<typename T, typename Storage>
+template<typename... Args>
+inline void Queue<T, Storage>::emplace(Args&&... args)
+{
+	HETERO_OPERATION(pushes);
+	elements.emplace_back(std::forward<Args>(args)...);
+}
+
+template<typename T, typename Storage>
+inline T Queue<T, Storage>::pop()
 {
+	HETERO_OPERATION(pops);
 	return elements.pop();
 }
 
-template<typename T>
-inline size_t Queue<T>::size() const
+template<typename T, typename Storage>
+inline void Queue<T, Storage>::push_range(const T *first, size_t amount)
+{
+	HETERO_OPERATION_N(pushes, amount);
+	reserve_storage(elements, elements.size() + amount);
+	for (size_t ind = 0; ind < amount; ind++) elements.push_back(first[ind]);
+}
+
+template<typename T, typename Storage>
+inline size_t Queue<T, Storage>::size() const
 {
 	return elements.size();
 }
 
-template<typename T>
-inline short Queue<T>::id() const
+template<typename T, typename Storage>
+inline short Queue<T, Storage>::id() const
 {
 	return 1;
 }
 
-template<typename T>
-inline bool Queue<T>::empty() const
+template<typename T, typename Storage>
+inline bool Queue<T, Storage>::empty() const
 {
 	return elements.empty();
 }
 
-template<typename T>
-inline BaseContainer<T>* Queue<T>::clone() const
+template<typename T, typename Storage>
+inline BaseContainer<T>* Queue<T, Storage>::clone() const
 {
-	return new Queue<T>(*this);
+	return new Queue<T, Storage>(*this);
 }
 
-template<typename T>
-inline BaseIterator<T>* Queue<T>::begin(bool useRegular) const
+template<typename T, typename Storage>
+inline MemoryUsage Queue<T, Storage>::memory_usage() const
+{
+	MemoryUsage usage = elements.heap_usage();
+	usage.overhead += sizeof(*this);
+
+	return usage;
+}
+
+template<typename T, typename Storage>
+inline BaseIterator<T>* Queue<T, Storage>::begin(bool useRegular) const
 {
 	return elements.begin();
 }
 
-template<typename T>
-inline BaseIterator<T>* Queue<T>::end() const
+template<typename T, typename Storage>
+inline BaseIterator<T>* Queue<T, Storage>::end() const
 {
 	return elements.end();
 }
 
-template<typename T>
-inline bool Queue<T>::operator==(const Queue<T> &other) const
+template<typename T, typename Storage>
+inline typename Queue<T, Storage>::Iterator Queue<T, Storage>::cbegin() const
+{
+	return elements.cbegin();
+}
+
+template<typename T, typename Storage>
+inline typename Queue<T, Storage>::Iterator Queue<T, Storage>::cend() const
+{
+	return elements.cend();
+}
+
+template<typename T, typename Storage>
+inline BaseIterator<T>* Queue<T, Storage>::lower_bound(const T &element, size_t &skipped) const
+{
+	HETERO_SCOPE();
+	return elements.lower_bound(element, skipped);
+}
+
+template<typename T, typename Storage>
+inline BaseIterator<T>* Queue<T, Storage>::upper_bound(const T &element, size_t &skipped) const
+{
+	HETERO_SCOPE();
+	return elements.upper_bound(element, skipped);
+}
+
+template<typename T, typename Storage>
+inline bool Queue<T, Storage>::operator==(const Queue<T, Storage> &other) const
+{
+	return elements == other.elements;
+}
+
+template<typename T, typename Storage>
+inline const Storage & Queue<T, Storage>::storage() const
 {
-	elements == other.elements;
+	return elements;
 }
 
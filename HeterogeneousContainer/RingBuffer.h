@@ -0,0 +1,525 @@
+#pragma once
+
+#include "BaseContainer.h"
+#include <assert.h>
+#include <algorithm>
+#include <new>
+#include <utility>
+
+template <typename T>
+class RingIterator;
+
+//Contiguous double ended queue - the default storage of Stack and Queue. The elements live in a single
+//growable buffer with a power of two capacity and wrap around its end, so pushing and popping at both
+//ends is amortized O(1) and every scan runs over at most two contiguous segments.
+template <typename T>
+class RingBuffer
+{
+public:
+	template <typename M>
+	friend class RingIterator;
+
+	RingBuffer();
+	RingBuffer(const RingBuffer<T>&);
+	RingBuffer(RingBuffer<T>&&) noexcept;
+	RingBuffer<T>& operator=(RingBuffer<T>);
+
+	bool contains(const T&) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate) const;
+	template <typename Predicate>
+	void filter(Predicate);
+	void sort();
+	void push(const T&); //push front
+	void push(T&&);
+	T pop(); //pop front
+	void push_back(const T&);
+	void push_back(T&&);
+	T pop_back();
+	template <typename... Args>
+	void emplace(Args&&...); //builds the element in place at the front
+	template <typename... Args>
+	void emplace_back(Args&&...);
+	const T& peek_front() const;
+	const T& peek_back() const;
+	size_t size() const;
+	bool empty() const;
+	void clear();
+	void reserve(size_t); //grows the buffer once for the given amount of elements
+	MemoryUsage heap_usage() const; //the buffer only - the object itself is left to its owner
+
+	BaseIterator<T>* begin(bool = true) const;
+	BaseIterator<T>* end() const;
+	BaseIterator<T>* lower_bound(const T&, size_t &skipped) const;
+	BaseIterator<T>* upper_bound(const T&, size_t &skipped) const;
+
+	//positional access for the order statistics of a sorted buffer
+	bool is_sorted() const; //in ascending order from the front - known without looking at the elements
+	const T& operator[](size_t) const; //the element on the given position counted from the front
+	size_t rank(const T&, bool inclusive = false) const; //the amount of leading elements smaller than (or equal to) the given one
+
+	//iterators held by value, so their calls are resolved at compile time
+	typedef RingIterator<T> Iterator;
+	Iterator cbegin() const;
+	Iterator cend() const;
+
+	bool operator==(const RingBuffer<T>&) const;
+
+	~RingBuffer();
+
+private:
+	T& at(size_t); //the element on the given position counted from the front
+	const T& at(size_t) const;
+	size_t slot(size_t) const;
+	void reallocate(size_t);
+
+	template <typename Predicate>
+	bool any_of(Predicate) const;
+
+	template <typename Before>
+	size_t partition_point(Before) const; //the amount of leading elements for which the predicate holds
+
+	static const size_t MIN_CAPACITY = 16;
+
+	T *buffer;
+	size_t capacity;
+	size_t head;
+	size_t count;
+	bool sorted; //set by sort() and kept while the pushes preserve the order; enables binary search
+};
+
+//reserves room in the storages that have a capacity; the rest (linked lists) ignore it
+template <typename T>
+void reserve_storage(RingBuffer<T> &storage, size_t amount)
+{
+	storage.reserve(amount);
+}
+
+template <typename Storage>
+void reserve_storage(Storage&, size_t)
+{}
+
+template <typename T>
+class RingIterator : public BaseIterator<T>
+{
+public:
+	RingIterator(const RingBuffer<T>*, size_t);
+
+	virtual void next() override;
+	virtual const T& value() const override;
+	virtual bool are_equal(BaseIterator<T>*) const override;
+	virtual BaseIterator<T>* clone() const override;
+
+private:
+	const RingBuffer<T> *elements;
+	size_t position;
+};
+
+template<typename T>
+inline RingBuffer<T>::RingBuffer()
+	: buffer(nullptr), capacity(0), head(0), count(0), sorted(true)
+{}
+
+template<typename T>
+inline RingBuffer<T>::RingBuffer(const RingBuffer<T> &other)
+	: RingBuffer()
+{
+	if (other.empty()) return;
+
+	reallocate(other.capacity);
+	for (size_t ind = 0; ind < other.count; ind++) push_back(other.at(ind));
+	sorted = other.sorted;
+}
+
+template<typename T>
+inline RingBuffer<T>::RingBuffer(RingBuffer<T> &&other) noexcept
+	: buffer(other.buffer), capacity(other.capacity), head(other.head), count(other.count), sorted(other.sorted)
+{
+	other.buffer = nullptr;
+	other.capacity = other.head = other.count = 0;
+	other.sorted = true;
+}
+
+template<typename T>
+inline RingBuffer<T>& RingBuffer<T>::operator=(RingBuffer<T> other)
+{
+	std::swap(buffer, other.buffer);
+	std::swap(capacity, other.capacity);
+	std::swap(head, other.head);
+	std::swap(count, other.count);
+	std::swap(sorted, other.sorted);
+
+	return *this;
+}
+
+template<typename T>
+inline bool RingBuffer<T>::contains(const T &element) const
+{
+	return any_of([&element](const T &crr) { HETERO_COUNT(comparisons); return crr == element; });
+}
+
+template<typename T>
+template<typename Predicate, typename>
+inline bool RingBuffer<T>::contains(Predicate pred) const
+{
+	return any_of([&pred](const T &crr) { HETERO_COUNT(predicateEvaluations); return pred(crr); });
+}
+
+template<typename T>
+template<typename Predicate>
+inline void RingBuffer<T>::filter(Predicate predicate)
+{
+	//stable compaction towards the front, then the surplus tail is destroyed
+	size_t kept = 0;
+	for (size_t ind = 0; ind < count; ind++)
+	{
+		HETERO_COUNT(predicateEvaluations);
+		if (predicate(at(ind))) continue;
+
+		if (kept != ind) at(kept) = std::move(at(ind));
+		++kept;
+	}
+
+	for (size_t ind = kept; ind < count; ind++) at(ind).~T();
+	count = kept;
+}
+
+template<typename T>
+inline void RingBuffer<T>::sort()
+{
+	if (head + count > capacity) reallocate(capacity); //the elements wrap around - make them contiguous first
+
+	std::sort(buffer + head, buffer + head + count, [](const T &left, const T &right) { HETERO_COUNT(comparisons); return left < right; });
+	sorted = true;
+}
+
+template<typename T>
+inline void RingBuffer<T>::push(const T &element)
+{
+	emplace(element);
+}
+
+template<typename T>
+inline void RingBuffer<T>::push(T &&element)
+{
+	emplace(std::move(element));
+}
+
+template<typename T>
+template<typename... Args>
+inline void RingBuffer<T>::emplace(Args&&... args)
+{
+	if (count == capacity)
+	{
+		//the arguments may refer to an element of the buffer, so the new element is built before the buffer moves
+		T element(std::forward<Args>(args)...);
+		reallocate(capacity == 0 ? MIN_CAPACITY : capacity * 2);
+		head = capacity - 1;
+		new (buffer + head) T(std::move(element));
+	}
+	else
+	{
+		size_t front = (head + capacity - 1) & (capacity - 1);
+		new (buffer + front) T(std::forward<Args>(args)...);
+		head = front;
+	}
+	++count;
+
+	sorted = sorted && (count == 1 || !(at(1) < at(0)));
+}
+
+template<typename T>
+inline T RingBuffer<T>::pop()
+{
+	assert(count != 0);
+
+	T save = std::move(buffer[head]);
+	buffer[head].~T();
+	head = (head + 1) & (capacity - 1);
+	--count;
+
+	return save;
+}
+
+template<typename T>
+inline void RingBuffer<T>::push_back(const T &element)
+{
+	emplace_back(element);
+}
+
+template<typename T>
+inline void RingBuffer<T>::push_back(T &&element)
+{
+	emplace_back(std::move(element));
+}
+
+template<typename T>
+template<typename... Args>
+inline void RingBuffer<T>::emplace_back(Args&&... args)
+{
+	if (count == capacity)
+	{
+		T element(std::forward<Args>(args)...);
+		reallocate(capacity == 0 ? MIN_CAPACITY : capacity * 2);
+		new (buffer + slot(count)) T(std::move(element));
+	}
+	else
+	{
+		new (buffer + slot(count)) T(std::forward<Args>(args)...);
+	}
+	++count;
+
+	sorted = sorted && (count == 1 || !(at(count - 1) < at(count - 2)));
+}
+
+template<typename T>
+inline T RingBuffer<T>::pop_back()
+{
+	assert(count != 0);
+
+	T &back = at(count - 1);
+	T save = std::move(back);
+	back.~T();
+	--count;
+
+	return save;
+}
+
+template<typename T>
+inline const T & RingBuffer<T>::peek_front() const
+{
+	assert(count != 0);
+
+	return at(0);
+}
+
+template<typename T>
+inline const T & RingBuffer<T>::peek_back() const
+{
+	assert(count != 0);
+
+	return at(count - 1);
+}
+
+template<typename T>
+inline size_t RingBuffer<T>::size() const
+{
+	return count;
+}
+
+template<typename T>
+inline bool RingBuffer<T>::empty() const
+{
+	return count == 0;
+}
+
+template<typename T>
+inline void RingBuffer<T>::clear()
+{
+	for (size_t ind = 0; ind < count; ind++) at(ind).~T();
+
+	head = 0;
+	count = 0;
+	sorted = true;
+}
+
+template<typename T>
+inline BaseIterator<T>* RingBuffer<T>::begin(bool) const
+{
+	return new RingIterator<T>(this, 0);
+}
+
+template<typename T>
+inline BaseIterator<T>* RingBuffer<T>::end() const
+{
+	return new RingIterator<T>(this, count);
+}
+
+template<typename T>
+inline typename RingBuffer<T>::Iterator RingBuffer<T>::cbegin() const
+{
+	return Iterator(this, 0);
+}
+
+template<typename T>
+inline typename RingBuffer<T>::Iterator RingBuffer<T>::cend() const
+{
+	return Iterator(this, count);
+}
+
+template<typename T>
+inline BaseIterator<T>* RingBuffer<T>::lower_bound(const T &element, size_t &skipped) const
+{
+	skipped = partition_point([&element](const T &crr) { HETERO_COUNT(comparisons); return crr < element; });
+
+	return new RingIterator<T>(this, skipped);
+}
+
+template<typename T>
+inline BaseIterator<T>* RingBuffer<T>::upper_bound(const T &element, size_t &skipped) const
+{
+	skipped = partition_point([&element](const T &crr) { HETERO_COUNT(comparisons); return !(element < crr); });
+
+	return new RingIterator<T>(this, skipped);
+}
+
+template<typename T>
+inline bool RingBuffer<T>::is_sorted() const
+{
+	return sorted;
+}
+
+template<typename T>
+inline const T & RingBuffer<T>::operator[](size_t position) const
+{
+	assert(position < count);
+
+	return at(position);
+}
+
+template<typename T>
+inline size_t RingBuffer<T>::rank(const T &element, bool inclusive) const
+{
+	if (inclusive) return partition_point([&element](const T &crr) { HETERO_COUNT(comparisons); return !(element < crr); });
+
+	return partition_point([&element](const T &crr) { HETERO_COUNT(comparisons); return crr < element; });
+}
+
+template<typename T>
+inline MemoryUsage RingBuffer<T>::heap_usage() const
+{
+	MemoryUsage usage;
+	usage.payload = count * sizeof(T);
+	usage.slack = (capacity - count) * sizeof(T);
+
+	return usage;
+}
+
+template<typename T>
+inline bool RingBuffer<T>::operator==(const RingBuffer<T> &other) const
+{
+	if (count != other.count) return false;
+
+	for (size_t ind = 0; ind < count; ind++)
+	{
+		if (at(ind) != other.at(ind)) return false;
+	}
+
+	return true;
+}
+
+template<typename T>
+inline RingBuffer<T>::~RingBuffer()
+{
+	clear();
+	::operator delete(buffer);
+}
+
+template<typename T>
+inline T & RingBuffer<T>::at(size_t position)
+{
+	return buffer[slot(position)];
+}
+
+template<typename T>
+inline const T & RingBuffer<T>::at(size_t position) const
+{
+	return buffer[slot(position)];
+}
+
+template<typename T>
+inline size_t RingBuffer<T>::slot(size_t position) const
+{
+	return (head + position) & (capacity - 1);
+}
+
+template<typename T>
+template<typename Predicate>
+inline bool RingBuffer<T>::any_of(Predicate pred) const
+{
+	//the elements form at most two contiguous segments - [head, firstEnd) and [0, wrapped)
+	size_t firstEnd = std::min(head + count, capacity);
+	size_t wrapped = head + count - firstEnd;
+
+	return std::find_if(buffer + head, buffer + firstEnd, pred) != buffer + firstEnd ||
+		std::find_if(buffer, buffer + wrapped, pred) != buffer + wrapped;
+}
+
+template<typename T>
+template<typename Before>
+inline size_t RingBuffer<T>::partition_point(Before before) const
+{
+	if (!sorted)
+	{
+		size_t position = 0;
+		while (position < count && before(at(position))) ++position;
+
+		return position;
+	}
+
+	size_t low = 0, high = count;
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (before(at(middle))) low = middle + 1;
+		else high = middle;
+	}
+
+	return low;
+}
+
+template<typename T>
+inline void RingBuffer<T>::reserve(size_t amount)
+{
+	if (amount <= capacity) return;
+
+	size_t newCapacity = capacity == 0 ? MIN_CAPACITY : capacity;
+	while (newCapacity < amount) newCapacity *= 2;
+	reallocate(newCapacity);
+}
+
+template<typename T>
+inline void RingBuffer<T>::reallocate(size_t newCapacity)
+{
+	//moves the elements to the beginning of a new buffer
+	T *newBuffer = static_cast<T*>(::operator new(newCapacity * sizeof(T)));
+	for (size_t ind = 0; ind < count; ind++)
+	{
+		new (newBuffer + ind) T(std::move(at(ind)));
+		at(ind).~T();
+	}
+
+	::operator delete(buffer);
+	buffer = newBuffer;
+	capacity = newCapacity;
+	head = 0;
+}
+
+template<typename T>
+inline RingIterator<T>::RingIterator(const RingBuffer<T> *elements, size_t position)
+	: elements(elements), position(position)
+{}
+
+template<typename T>
+inline void RingIterator<T>::next()
+{
+	++position;
+}
+
+template<typename T>
+inline const T& RingIterator<T>::value() const
+{
+	return elements->at(position);
+}
+
+template<typename T>
+inline bool RingIterator<T>::are_equal(BaseIterator<T> *other) const
+{
+	return ((RingIterator<T>*)other)->position == position;
+}
+
+template<typename T>
+inline BaseIterator<T>* RingIterator<T>::clone() const
+{
+	return new RingIterator<T>(*this);
+}
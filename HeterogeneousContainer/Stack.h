@@ -4,119 +4,227 @@
 #include <assert.h>
 #include <algorithm>
 #include "DoublyLinkedList.h"
+#include "RingBuffer.h"
 
-template <typename T>
+//Storage keeps the elements - a contiguous RingBuffer by default; DoublyLinkedList<T> (with any node allocator) fits as well
+template <typename T, typename Storage = RingBuffer<T>>
 class Stack : public BaseContainer<T>
 {
 public:
 	Stack();
 
 	virtual bool contains(const T&) const override;
-	virtual bool contains(Condition<T>) const;
-	virtual void filter(Condition<T>);
+	virtual bool contains(PredicateRef<T>) const override;
+	virtual void filter(PredicateRef<T>) override;
 	virtual void sort();
 	virtual void push(const T&) override;
+	virtual void push(T&&) override;
 	virtual T pop() override;
+	virtual void push_range(const T*, size_t) override;
 	virtual size_t size() const override;
 	virtual short id() const override;
 	virtual bool empty() const override;
 	virtual BaseContainer<T>* clone() const override;
+	virtual MemoryUsage memory_usage() const override;
 
 	virtual BaseIterator<T>* begin(bool = true) const override;
 	virtual BaseIterator<T>* end() const override;
+	virtual BaseIterator<T>* lower_bound(const T&, size_t&) const override;
+	virtual BaseIterator<T>* upper_bound(const T&, size_t&) const override;
 
-	bool operator==(const Stack<T>&) const;
+	//iterators of the storage held by value, so their calls are resolved at compile time
+	typedef typename Storage::Iterator Iterator;
+	Iterator cbegin() const;
+	Iterator cend() const;
+
+	//the same as the virtual overloads with the predicate inlined into the scan of the storage
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	void filter(Predicate);
+
+	template <typename... Args>
+	void emplace(Args&&...); //builds the element in place in the storage
+
+	bool operator==(const Stack<T, Storage>&) const;
+	const Storage& storage() const; //read only access for the searches that need positions
 
 	const T& top() const;
 private:
 
-	DoublyLinkedList<T> elements;
+	Storage elements;
 };
 
-template<typename T>
-inline Stack<T>::Stack()
+template<typename T, typename Storage>
+inline Stack<T, Storage>::Stack()
 {}
 
-template<typename T>
-inline bool Stack<T>::contains(const T &element) const
+template<typename T, typename Storage>
+inline bool Stack<T, Storage>::contains(const T &element) const
 {
+	HETERO_OPERATION(containsProbes);
 	return elements.contains(element);
 }
 
-template<typename T>
-inline bool Stack<T>::contains(Condition<T> pred) const
+template<typename T, typename Storage>
+inline bool Stack<T, Storage>::contains(PredicateRef<T> pred) const
+{
+	HETERO_OPERATION(containsProbes);
+	return elements.contains(pred);
+}
+
+template<typename T, typename Storage>
+inline void Stack<T, Storage>::filter(PredicateRef<T> predicate)
+{
+	HETERO_SCOPE();
+	elements.filter(predicate);
+}
+
+template<typename T, typename Storage>
+template<typename Predicate, typename>
+inline bool Stack<T, Storage>::contains(Predicate pred) const
 {
+	HETERO_OPERATION(containsProbes);
 	return elements.contains(pred);
 }
 
-template<typename T>
-inline void Stack<T>::filter(Condition<T> predicate)
+template<typename T, typename Storage>
+template<typename Predicate, typename>
+inline void Stack<T, Storage>::filter(Predicate predicate)
 {
+	HETERO_SCOPE();
 	elements.filter(predicate);
 }
 
-template<typename T>
-inline void Stack<T>::sort()
+template<typename T, typename Storage>
+inline void Stack<T, Storage>::sort()
 {
+	HETERO_SCOPE();
 	elements.sort();
 }
 
-template<typename T>
-inline void Stack<T>::push(const T &element)
+template<typename T, typename Storage>
+inline void Stack<T, Storage>::push(const T &element)
 {
+	HETERO_OPERATION(pushes);
 	elements.push(element);
 }
 
-template<typename T>
-inline T Stack<T>::pop()
+template<typename T, typename Storage>
+inline void Stack<T, Storage>::push(T &&element)
+{
+	HETERO_OPERATION(pushes);
+	elements.push(std::move(element));
+}
+
+template<typename T, typename Storage>
+template<typename... Args>
+inline void Stack<T, Storage>::emplace(Args&&... args)
+{
+	HETERO_OPERATION(pushes);
+	elements.emplace(std::forward<Args>(args)...);
+}
+
+template<typename T, typename Storage>
+inline T Stack<T, Storage>::pop()
 {
+	HETERO_OPERATION(pops);
 	return elements.pop();
 }
 
-template<typename T>
-inline size_t Stack<T>::size() const
+template<typename T, typename Storage>
+inline void Stack<T, Storage>::push_range(const T *first, size_t amount)
+{
+	HETERO_OPERATION_N(pushes, amount);
+	reserve_storage(elements, elements.size() + amount);
+	for (size_t ind = 0; ind < amount; ind++) elements.push(first[ind]);
+}
+
+template<typename T, typename Storage>
+inline size_t Stack<T, Storage>::size() const
 {
 	return elements.size();
 }
 
-template<typename T>
-inline short Stack<T>::id() const
+template<typename T, typename Storage>
+inline short Stack<T, Storage>::id() const
 {
 	return 0;
 }
 
-template<typename T>
-inline bool Stack<T>::empty() const
+template<typename T, typename Storage>
+inline bool Stack<T, Storage>::empty() const
 {
 	return elements.empty();
 }
 
-template<typename T>
-inline BaseContainer<T>* Stack<T>::clone() const
+template<typename T, typename Storage>
+inline BaseContainer<T>* Stack<T, Storage>::clone() const
 {
-	return new Stack<T>(*this);
+	return new Stack<T, Storage>(*this);
 }
 
-template<typename T>
-inline BaseIterator<T>* Stack<T>::begin(bool useRegular) const
+template<typename T, typename Storage>
+inline MemoryUsage Stack<T, Storage>::memory_usage() const
+{
+	MemoryUsage usage = elements.heap_usage();
+	usage.overhead += sizeof(*this);
+
+	return usage;
+}
+
+template<typename T, typename Storage>
+inline BaseIterator<T>* Stack<T, Storage>::begin(bool useRegular) const
 {
 	return elements.begin();
 }
 
-template<typename T>
-inline BaseIterator<T>* Stack<T>::end() const
+template<typename T, typename Storage>
+inline BaseIterator<T>* Stack<T, Storage>::end() const
 {
 	return elements.end();
 }
 
-template<typename T>
-inline bool Stack<T>::operator==(const Stack<T> &other) const
+template<typename T, typename Storage>
+inline typename Stack<T, Storage>::Iterator Stack<T, Storage>::cbegin() const
+{
+	return elements.cbegin();
+}
+
+template<typename T, typename Storage>
+inline typename Stack<T, Storage>::Iterator Stack<T, Storage>::cend() const
+{
+	return elements.cend();
+}
+
+template<typename T, typename Storage>
+inline BaseIterator<T>* Stack<T, Storage>::lower_bound(const T &element, size_t &skipped) const
+{
+	HETERO_SCOPE();
+	return elements.lower_bound(element, skipped);
+}
+
+template<typename T, typename Storage>
+inline BaseIterator<T>* Stack<T, Storage>::upper_bound(const T &element, size_t &skipped) const
+{
+	HETERO_SCOPE();
+	return elements.upper_bound(element, skipped);
+}
+
+template<typename T, typename Storage>
+inline bool Stack<T, Storage>::operator==(const Stack<T, Storage> &other) const
 {
 	return elements == other.elements;
 }
 
-template<typename T>
-inline const T & Stack<T>::top() const
+template<typename T, typename Storage>
+inline const Storage & Stack<T, Storage>::storage() const
+{
+	return elements;
+}
+
+template<typename T, typename Storage>
+inline const T & Stack<T, Storage>::top() const
 {
 	assert(!elements.empty());
 
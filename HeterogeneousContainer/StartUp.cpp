@@ -1,10 +1,12 @@
 // HeterogeneousContainer.cpp : Defines the entry point for the console application.
 //
 
-//Needed it order to check for memory leaks
+//Needed it order to check for memory leaks (MSVC only)
+#ifdef _MSC_VER
 #define _CRTDBG_MAP_ALLOC  
 #include <stdlib.h>  
 #include <crtdbg.h>  
+#endif
 //-----------------------------------------
 
 #include "Stack.h"
@@ -15,8 +17,10 @@
 
 #include <iostream>
 #include <fstream>
+#include <string>
 
 #include "Tests.h"
+#include "Benchmarks.h"
 
 HeteroContainer<int> read_container(const char *fileName)
 {
@@ -27,9 +31,31 @@ HeteroContainer<int> read_container(const char *fileName)
 	return result;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+#ifdef _MSC_VER
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF); //It checks for memory leaks
+#endif
+
+	//--benchmark [--quick] [--csv file] [--json file]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		BenchmarkOptions options;
+		for (int ind = 2; ind < argc; ind++)
+		{
+			std::string argument = argv[ind];
+			if (argument == "--quick") options.quick = true;
+			else if (argument == "--csv" && ind + 1 < argc) options.csvFile = argv[++ind];
+			else if (argument == "--json" && ind + 1 < argc) options.jsonFile = argv[++ind];
+			else
+			{
+				std::cerr << "Usage: " << argv[0] << " --benchmark [--quick] [--csv file] [--json file]\n";
+				return 1;
+			}
+		}
+
+		return ExecuteBenchmarks(options) ? 0 : 1;
+	}
 
 	ExecuteTests();
 	HeteroContainer<int> list = read_container("listExample.txt");
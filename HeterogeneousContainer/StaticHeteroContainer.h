@@ -0,0 +1,326 @@
+#pragma once
+
+#include "HeteroContainer.h"
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+//Heterogeneous container whose subcontainers are values of a closed set of types instead of BaseContainer
+//pointers. They are stored next to each other in a single vector and every operation is dispatched with
+//std::visit, so the concrete container code (and the predicates passed to it) is inlined into the loops.
+//The sort iterator is a value as well and steps the iterators of the subcontainers without virtual calls.
+template <typename T>
+class StaticHeteroContainer
+{
+public:
+	typedef typename HeteroContainer<T>::Type Type;
+
+	StaticHeteroContainer();
+
+	void add_container(Type);
+	void add_element(const T&); //balanced loading - goes to the smallest subcontainer
+	void add_element(T&&);
+	template <typename... Args>
+	void emplace_element(Args&&...);
+	bool contains(const T&) const;
+	void sort();
+
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	bool contains(Predicate) const;
+	template <typename Predicate, typename = EnableIfPredicate<Predicate, T>>
+	void filter(Predicate);
+
+	//calls visitor(element) for every element, subcontainer by subcontainer
+	template <typename Visitor>
+	void for_each(Visitor) const;
+
+	size_t elements_size() const;
+	size_t containers_size() const;
+	Type container_type(size_t) const;
+
+	class SortIterator;
+	SortIterator begin() const; //Container should be sorted in order for the iterator to work properly
+	SortIterator end() const;
+
+private:
+	typedef std::variant<Stack<T>, Queue<T>, DoublyLinkedList<T>, BinSearchTree<T>> Subcontainer;
+
+	//the iterators of a subcontainer together with its end; stacks and queues share the iterator type
+	template <typename Iterator>
+	struct Cursor
+	{
+		Iterator crr;
+		Iterator end;
+	};
+
+	static_assert(std::is_same<typename Stack<T>::Iterator, typename Queue<T>::Iterator>::value,
+		"stacks and queues are expected to share their storage iterator");
+	typedef std::variant<Cursor<typename Stack<T>::Iterator>, Cursor<typename DoublyLinkedList<T>::Iterator>,
+		Cursor<typename BinSearchTree<T>::Iterator>> AnyCursor;
+
+	//heap order for balanced loading - the smallest subcontainer (the first one on ties) is on top
+	struct LargerSize
+	{
+		const std::vector<size_t> *sizes;
+
+		bool operator()(size_t, size_t) const;
+	};
+
+	void rebuild_sizes();
+	template <typename Push>
+	void push_to_smallest(Push);
+
+	std::vector<Subcontainer> containers;
+	std::vector<size_t> sizes; //cached size of every subcontainer
+	std::vector<size_t> sizeHeap; //indexes of the subcontainers
+	size_t count; //the amount of elements in all subcontainers
+
+public:
+	class SortIterator
+	{
+	public:
+		SortIterator(const std::vector<Subcontainer>&, size_t, bool = false);
+
+		SortIterator& operator++();
+		const T& operator*() const;
+		bool operator!= (const SortIterator&) const;
+
+	private:
+		void refresh(size_t);
+
+		std::vector<AnyCursor> cursors;
+		LoserTree<T> heads; //k-way merge over the cached current values of the cursors
+		size_t processedElements;
+	};
+};
+
+template<typename T>
+inline StaticHeteroContainer<T>::StaticHeteroContainer()
+	: count(0)
+{}
+
+template<typename T>
+inline void StaticHeteroContainer<T>::add_container(Type type)
+{
+	switch (type)
+	{
+	case HeteroContainer<T>::STACK:
+		containers.emplace_back(std::in_place_type<Stack<T>>);
+		break;
+	case HeteroContainer<T>::QUEUE:
+		containers.emplace_back(std::in_place_type<Queue<T>>);
+		break;
+	case HeteroContainer<T>::LINKED_LIST:
+		containers.emplace_back(std::in_place_type<DoublyLinkedList<T>>);
+		break;
+	case HeteroContainer<T>::BIN_SEARCH_TREE:
+	case HeteroContainer<T>::BALANCED_BIN_SEARCH_TREE:
+		containers.emplace_back(std::in_place_type<BinSearchTree<T>>, type == HeteroContainer<T>::BALANCED_BIN_SEARCH_TREE);
+		break;
+	default: //not a subcontainer type - nothing is added, so the sizes stay in step with the subcontainers
+		assert(false);
+		return;
+	}
+
+	sizes.push_back(0);
+	sizeHeap.push_back(containers.size() - 1);
+	std::push_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &sizes });
+}
+
+template<typename T>
+inline void StaticHeteroContainer<T>::add_element(const T &element)
+{
+	push_to_smallest([&element](auto &container) { container.push(element); });
+}
+
+template<typename T>
+inline void StaticHeteroContainer<T>::add_element(T &&element)
+{
+	push_to_smallest([&element](auto &container) { container.push(std::move(element)); });
+}
+
+template<typename T>
+template<typename... Args>
+inline void StaticHeteroContainer<T>::emplace_element(Args&&... args)
+{
+	push_to_smallest([&args...](auto &container) { container.emplace(std::forward<Args>(args)...); });
+}
+
+template<typename T>
+inline bool StaticHeteroContainer<T>::contains(const T &element) const
+{
+	for (const Subcontainer &container : containers)
+	{
+		if (std::visit([&element](const auto &crr) { return crr.contains(element); }, container)) return true;
+	}
+
+	return false;
+}
+
+template<typename T>
+inline void StaticHeteroContainer<T>::sort()
+{
+	for (Subcontainer &container : containers) std::visit([](auto &crr) { crr.sort(); }, container);
+}
+
+template<typename T>
+template<typename Predicate, typename>
+inline bool StaticHeteroContainer<T>::contains(Predicate pred) const
+{
+	for (const Subcontainer &container : containers)
+	{
+		if (std::visit([&pred](const auto &crr) { return crr.contains(pred); }, container)) return true;
+	}
+
+	return false;
+}
+
+template<typename T>
+template<typename Predicate, typename>
+inline void StaticHeteroContainer<T>::filter(Predicate predicate)
+{
+	for (Subcontainer &container : containers) std::visit([&predicate](auto &crr) { crr.filter(predicate); }, container);
+
+	rebuild_sizes();
+}
+
+template<typename T>
+template<typename Visitor>
+inline void StaticHeteroContainer<T>::for_each(Visitor visitor) const
+{
+	for (const Subcontainer &container : containers)
+	{
+		std::visit([&visitor](const auto &crr)
+		{
+			auto end = crr.cend();
+			for (auto it = crr.cbegin(); !it.are_equal(&end); it.next()) visitor(it.value());
+		}, container);
+	}
+}
+
+template<typename T>
+inline size_t StaticHeteroContainer<T>::elements_size() const
+{
+	return count;
+}
+
+template<typename T>
+inline size_t StaticHeteroContainer<T>::containers_size() const
+{
+	return containers.size();
+}
+
+template<typename T>
+inline typename StaticHeteroContainer<T>::Type StaticHeteroContainer<T>::container_type(size_t ind) const
+{
+	return (Type)std::visit([](const auto &crr) { return crr.id(); }, containers[ind]);
+}
+
+template<typename T>
+inline typename StaticHeteroContainer<T>::SortIterator StaticHeteroContainer<T>::begin() const
+{
+	return SortIterator(containers, count);
+}
+
+template<typename T>
+inline typename StaticHeteroContainer<T>::SortIterator StaticHeteroContainer<T>::end() const
+{
+	return SortIterator(containers, count, true);
+}
+
+template<typename T>
+inline bool StaticHeteroContainer<T>::LargerSize::operator()(size_t left, size_t right) const
+{
+	if ((*sizes)[left] != (*sizes)[right]) return (*sizes)[left] > (*sizes)[right];
+
+	return left > right;
+}
+
+template<typename T>
+template<typename Push>
+inline void StaticHeteroContainer<T>::push_to_smallest(Push push)
+{
+	assert(!containers.empty());
+
+	std::pop_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &sizes });
+	size_t smallest = sizeHeap.back();
+	std::visit(push, containers[smallest]);
+	++sizes[smallest];
+	++count;
+	std::push_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &sizes });
+}
+
+template<typename T>
+inline void StaticHeteroContainer<T>::rebuild_sizes()
+{
+	count = 0;
+	for (size_t ind = 0; ind < containers.size(); ind++)
+	{
+		sizes[ind] = std::visit([](const auto &crr) { return crr.size(); }, containers[ind]);
+		count += sizes[ind];
+	}
+
+	std::make_heap(sizeHeap.begin(), sizeHeap.end(), LargerSize{ &sizes });
+}
+
+template<typename T>
+inline StaticHeteroContainer<T>::SortIterator::SortIterator(const std::vector<Subcontainer> &containers, size_t count, bool isEnd)
+	: processedElements(0)
+{
+	if (isEnd)
+	{
+		processedElements = count;
+		return;
+	}
+
+	for (const Subcontainer &container : containers)
+	{
+		cursors.push_back(std::visit([](const auto &crr) -> AnyCursor
+		{
+			return Cursor<typename std::decay_t<decltype(crr)>::Iterator>{ crr.cbegin(), crr.cend() };
+		}, container));
+	}
+
+	heads = LoserTree<T>(cursors.size());
+	for (size_t ind = 0; ind < cursors.size(); ind++) refresh(ind);
+	heads.build();
+
+	if (heads.winner() != -1) ++processedElements;
+}
+
+template<typename T>
+inline typename StaticHeteroContainer<T>::SortIterator & StaticHeteroContainer<T>::SortIterator::operator++()
+{
+	size_t crrMin = heads.winner();
+	std::visit([](auto &cursor) { cursor.crr.next(); }, cursors[crrMin]);
+	refresh(crrMin);
+	heads.replay(crrMin);
+
+	if (heads.winner() != -1) ++processedElements;
+
+	return *this;
+}
+
+template<typename T>
+inline const T & StaticHeteroContainer<T>::SortIterator::operator*() const
+{
+	return heads.top();
+}
+
+template<typename T>
+inline bool StaticHeteroContainer<T>::SortIterator::operator!=(const SortIterator &other) const
+{
+	return heads.winner() != other.heads.winner() || processedElements != other.processedElements;
+}
+
+template<typename T>
+inline void StaticHeteroContainer<T>::SortIterator::refresh(size_t ind)
+{
+	std::visit([this, ind](auto &cursor)
+	{
+		if (cursor.crr.are_equal(&cursor.end)) heads.exhaust(ind);
+		else heads.set(ind, cursor.crr.value());
+	}, cursors[ind]);
+}
@@ -5,6 +5,34 @@
 #include "DoublyLinkedList.h"
 #include "BinSearchTree.h"
 #include "HeteroContainer.h"
+#include "StaticHeteroContainer.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//counts the copies of its instances, so the tests can check that the elements are only moved
+struct Tracked
+{
+	static size_t copies;
+	int value;
+
+	Tracked(int value = 0) : value(value) {}
+	Tracked(const Tracked &other) : value(other.value) { ++copies; }
+	Tracked(Tracked&&) = default;
+	Tracked& operator=(const Tracked &other) { value = other.value; ++copies; return *this; }
+	Tracked& operator=(Tracked&&) = default;
+
+	bool operator<(const Tracked &other) const { return value < other.value; }
+	bool operator>(const Tracked &other) const { return value > other.value; }
+	bool operator==(const Tracked &other) const { return value == other.value; }
+};
+
+size_t Tracked::copies = 0;
 
 void TestStack()
 {
@@ -88,6 +116,59 @@ void TestQueue()
 
 	while (!que.empty()) que.pop();
 	assert(que.size() == 0);
+
+	Queue<std::string> words; //the contents wrap around the end of the ring buffer
+	for (int ind = 0; ind < 12; ind++) words.push(std::to_string(ind));
+	for (int ind = 0; ind < 10; ind++) words.pop();
+	for (int ind = 0; ind < 10; ind++) words.push(std::to_string(20 - ind));
+	words.filter([](const std::string &word) { return word.back() == '1'; });
+	assert(words.size() == 10 && !words.contains("11") && words.contains("20"));
+
+	words.sort();
+	BaseIterator<std::string> *wordsIt = words.begin();
+	BaseIterator<std::string> *wordsEnd = words.end();
+	std::string previous;
+	while (!wordsIt->are_equal(wordsEnd))
+	{
+		assert(previous <= wordsIt->value());
+
+		previous = wordsIt->value();
+		wordsIt->next();
+	}
+	delete wordsIt;
+	delete wordsEnd;
+}
+
+void TestDoublyLinkedList()
+{
+	DoublyLinkedList<int> list;
+	for (int ind = 0; ind < 1000; ind++) list.push((ind * 7919) % 101);
+
+	list.sort();
+	assert(list.size() == 1000);
+	assert(list.peek_front() == 0 && list.peek_back() == 100);
+
+	int previous = list.peek_back();
+	while (!list.empty())
+	{
+		int crr = list.pop_back();
+		assert(crr <= previous);
+
+		previous = crr;
+	}
+
+	DoublyLinkedList<std::string> words;
+	for (int ind = 0; ind < 100; ind++) words.push_back(std::to_string(ind));
+	for (int ind = 0; ind < 50; ind++) words.pop();
+	for (int ind = 0; ind < 50; ind++) words.push(std::to_string(ind)); //reuses the released nodes
+	assert(words.size() == 100 && words.peek_front() == "49" && words.peek_back() == "99");
+
+	Queue<int, DoublyLinkedList<int, HeapAllocator>> queue;
+	for (int ind = 0; ind < 100; ind++) queue.push(ind);
+	Queue<int, DoublyLinkedList<int, HeapAllocator>> copy = queue;
+	assert(copy == queue);
+	while (!queue.empty()) queue.pop();
+	assert(copy.size() == 100);
 }
 
 void TestBinSearchTree()
@@ -125,6 +206,170 @@ void TestBinSearchTree()
 	tree.filter([](const int &number) { return number % 2 == 0; });
 	assert(tree.size() == 4);
 	assert(!tree.contains([](const int &number) { return number % 2 == 0; }));
+
+	//a plain tree built from a pre-order sequence gives the same sequence back
+	int preOrder[] = { 50, 30, 20, 10, 25, 40, 45, 70, 60, 65, 80, 90 };
+	BinSearchTree<int> shaped;
+	for (int number : preOrder) shaped.push(number);
+
+	it = shaped.begin(false);
+	end = shaped.end();
+	std::vector<int> visited;
+	for (; !it->are_equal(end); it->next()) visited.push_back(it->value());
+	delete it; delete end;
+	assert(visited == std::vector<int>(std::begin(preOrder), std::end(preOrder)));
+
+	//sorting a degenerate tree rebuilds it as a complete tree - the median ends up in the root
+	BinSearchTree<std::string> chain;
+	for (int number = 0; number < 1023; number++) chain.push(std::to_string(10000 + number));
+	chain.sort();
+	BaseIterator<std::string> *top = chain.begin(false);
+	assert(top->value() == "10511");
+	delete top;
+
+	BaseIterator<std::string> *sorted = chain.begin();
+	BaseIterator<std::string> *sortedEnd = chain.end();
+	int expected = 10000;
+	for (; !sorted->are_equal(sortedEnd); sorted->next()) assert(sorted->value() == std::to_string(expected++));
+	assert(expected == 11023 && chain.size() == 1023);
+	delete sorted; delete sortedEnd;
+
+	chain.push("09999");
+	chain.remove("10511");
+	assert(chain.contains("09999") && !chain.contains("10511") && chain.size() == 1023);
+
+	chain.filter([](const std::string &number) { return number.back() != '0'; });
+	assert(chain.size() == 103 && chain.contains("10510") && !chain.contains("10511"));
+	sorted = chain.begin();
+	sortedEnd = chain.end();
+	expected = 10000;
+	for (; !sorted->are_equal(sortedEnd); sorted->next(), expected += 10) assert(sorted->value() == std::to_string(expected));
+	assert(expected == 11030);
+	delete sorted; delete sortedEnd;
+}
+
+void TestBalancedBinSearchTree()
+{
+	BinSearchTree<int> tree(true);
+	for (int number = 0; number < 10000; number++) tree.push(number / 2);
+
+	assert(tree.id() == 4);
+	assert(tree.size() == 10000);
+	assert(tree.contains(0) && tree.contains(4999) && !tree.contains(5000));
+
+	tree.remove(100);
+	assert(!tree.contains(100));
+	assert(tree.size() == 9998);
+
+	tree.filter([](const int &number) { return number % 3 == 0; });
+	assert(!tree.contains([](const int &number) { return number % 3 == 0; }));
+
+	BinSearchTree<int> copy = tree;
+	BaseIterator<int> *it = copy.begin();
+	BaseIterator<int> *end = copy.end();
+	size_t count = 0;
+	int previous = -1;
+	while (!it->are_equal(end))
+	{
+		assert(previous <= it->value());
+
+		previous = it->value();
+		it->next();
+		++count;
+	}
+	assert(count == tree.size());
+
+	delete it; delete end;
+
+	//the rotations and removals keep the parent links the iterators walk on
+	it = copy.begin(false);
+	end = copy.end();
+	count = 0;
+	for (; !it->are_equal(end); it->next()) ++count;
+	assert(count == copy.size());
+
+	delete it; delete end;
+}
+
+void TestOrderStatistics()
+{
+	BinSearchTree<int> tree(true);
+	for (int number = 0; number < 1000; number++) tree.push(number / 2);
+	tree.remove(10);
+	tree.filter([](const int &number) { return number >= 400; });
+
+	assert(tree.select(0) == 0 && tree.select(19) == 9 && tree.select(20) == 11 && tree.select(797) == 399);
+	assert(tree.rank(10) == 20 && tree.rank(11) == 20 && tree.rank(11, true) == 22);
+	assert(tree.count_range(0, 400) == 798 && tree.count_range(5, 15) == 18 && tree.count_range(15, 5) == 0);
+
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 11; ind++) cont.add_container((HeteroContainer<int>::Type)(ind % 5));
+	std::vector<int> expected;
+	for (int ind = 0; ind < 2000; ind++)
+	{
+		int element = (ind * 7919) % 601 - 300;
+		cont.add_element(element);
+		expected.push_back(element);
+	}
+	std::sort(expected.begin(), expected.end());
+
+	for (size_t position = 0; position < expected.size(); position += 7) assert(cont.select(position) == expected[position]);
+	assert(cont.select(expected.size() - 1) == expected.back());
+
+	//sorted stacks and queues are searched in their buffers instead of being copied
+	Queue<int> queue;
+	for (int number = 0; number < 20; number++) queue.push(number / 2);
+	assert(queue.storage().is_sorted() && queue.storage()[5] == 2);
+	assert(queue.storage().rank(3) == 6 && queue.storage().rank(3, true) == 8 && queue.storage().rank(10) == 20);
+	cont.sort();
+	for (size_t position = 0; position < expected.size(); position += 7) assert(cont.select(position) == expected[position]);
+}
+
+bool IsNegative(const int &number)
+{
+	return number < 0;
+}
+
+void TestPredicates()
+{
+	int threshold = 250;
+	auto aboveThreshold = [&threshold](const int &number) { return number > threshold; };
+
+	Stack<int> st;
+	DoublyLinkedList<int> list;
+	BinSearchTree<int> tree;
+	BaseContainer<int> *containers[] = { &st, &list, &tree };
+	for (BaseContainer<int> *container : containers)
+	{
+		for (int number = -300; number <= 300; number++) container->push(number);
+
+		//through the virtual interface
+		assert(container->contains(aboveThreshold) && container->contains(IsNegative));
+		container->filter(aboveThreshold);
+		assert(!container->contains(aboveThreshold) && container->size() == 551);
+	}
+
+	threshold = 0;
+	assert(st.contains(aboveThreshold) && list.contains(aboveThreshold) && tree.contains(aboveThreshold));
+	st.filter(aboveThreshold);
+	list.filter(IsNegative);
+	tree.filter([threshold](const int &number) { return number != threshold; });
+	assert(st.size() == 301 && list.size() == 251 && tree.size() == 1);
+
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 10; ind++) cont.add_container((HeteroContainer<int>::Type)(ind % 5));
+	for (int number = -500; number < 500; number++) cont.add_element(number);
+
+	size_t calls = 0;
+	auto counted = [&calls](const int &number) { ++calls; return number % 7 == 0; };
+	cont.filter(counted);
+	assert(calls == 1000 && cont.elements_size() == 857);
+	assert(!cont.contains([](const int &number) { return number % 7 == 0; }) && cont.contains(IsNegative));
+
+	threshold = 450;
+	assert(cont.contains(aboveThreshold, 4));
+	cont.filter(aboveThreshold, 4);
+	assert(!cont.contains(aboveThreshold) && cont.contains(threshold));
 }
 
 void TestHetero()
@@ -150,6 +395,8 @@ void TestHetero()
 
 		++ind;
 	}
+	assert(cont.container_type(1) == HeteroContainer<int>::LINKED_LIST);
+	assert(cont.container_size(0) == 2 && cont.container_size(3) == 1);
 
 	cont.add_element(14);
 	cont.add_element(34);
@@ -173,6 +420,7 @@ void TestHetero()
 	cont.filter([](const int &number) { return number == 4; });
 	assert(cont.containers_size() == 4);
 	assert(cont.elements_size() == 16);
+	assert(cont.container_size(0) + cont.container_size(1) + cont.container_size(2) + cont.container_size(3) == 16);
 	assert(cont.contains(4) == false);
 	assert(cont.contains(17) == false);
 
@@ -186,10 +434,628 @@ void TestHetero()
 	assert(cont.get_element_it(-666) != cont.end());
 }
 
+void TestHeteroBulkLoad()
+{
+	HeteroContainer<int> bulk, single;
+	HeteroContainer<int>::Type types[] = { HeteroContainer<int>::STACK, HeteroContainer<int>::QUEUE, HeteroContainer<int>::LINKED_LIST,
+		HeteroContainer<int>::BIN_SEARCH_TREE, HeteroContainer<int>::BALANCED_BIN_SEARCH_TREE };
+	for (HeteroContainer<int>::Type type : types)
+	{
+		bulk.add_container(type);
+		single.add_container(type);
+	}
+
+	std::vector<int> elements;
+	for (int ind = 0; ind < 1000; ind++) elements.push_back(ind * 7919 % 1009 - 500);
+
+	//uneven sizes first, so the batches have to even them out
+	for (int ind = 0; ind < 3; ind++)
+	{
+		bulk.add_element(ind);
+		single.add_element(ind);
+	}
+	bulk.add_elements(elements.data(), 10);
+	bulk.add_elements(elements.begin() + 10, elements.end());
+	for (int element : elements) single.add_element(element);
+
+	assert(bulk.elements_size() == single.elements_size());
+	for (size_t ind = 0; ind < bulk.containers_size(); ind++) assert(bulk.container_size(ind) == single.container_size(ind));
+
+	bulk.sort();
+	single.sort();
+	HeteroContainer<int>::SortIterator singleIt = single.begin();
+	for (int element : bulk)
+	{
+		assert(element == *singleIt);
+		++singleIt;
+	}
+	assert(!(singleIt != single.end()));
+
+	//a large batch is merged and rebalanced, a small one is inserted
+	BinSearchTree<int> tree(true);
+	tree.push_range(elements.data(), elements.size());
+	tree.push_range(elements.data(), 3);
+	std::vector<int> sorted(elements);
+	sorted.insert(sorted.end(), elements.begin(), elements.begin() + 3);
+	std::sort(sorted.begin(), sorted.end());
+	assert(tree.size() == sorted.size());
+	for (size_t ind = 0; ind < sorted.size(); ind++) assert(tree.select(ind) == sorted[ind]);
+}
+
+void TestMoveSemantics()
+{
+	Tracked::copies = 0;
+
+	Stack<Tracked> stack;
+	Queue<Tracked> queue;
+	DoublyLinkedList<Tracked> list;
+	BinSearchTree<Tracked> tree(true);
+	for (int ind = 0; ind < 100; ind++)
+	{
+		stack.push(Tracked(ind));
+		queue.emplace(ind);
+		list.emplace_back(ind);
+		tree.emplace(ind);
+	}
+
+	Stack<Tracked> movedStack(std::move(stack));
+	DoublyLinkedList<Tracked> movedList(std::move(list));
+	BinSearchTree<Tracked> movedTree(std::move(tree));
+	assert(movedStack.size() == 100 && stack.size() == 0);
+	assert(movedList.size() == 100 && list.size() == 0);
+	assert(movedTree.size() == 100 && tree.size() == 0);
+	assert(movedStack.pop().value == 99 && queue.pop().value == 0 && movedList.pop_back().value == 99);
+
+	//the tree moves a popped element out and a successor into the place of a removed node
+	for (int ind = 0; ind < 100; ind += 3) movedTree.remove(Tracked(ind));
+	for (int ind = 0; ind < 30; ind++) movedTree.pop();
+	movedTree.emplace(300);
+	movedTree.emplace(300);
+	movedTree.remove(movedTree.select(movedTree.rank(300))); //an element of the tree itself, with its duplicates
+	assert(movedTree.size() == 36 && !movedTree.contains(Tracked(300)));
+
+	HeteroContainer<Tracked> cont;
+	for (int ind = 0; ind < 5; ind++) cont.add_container((HeteroContainer<Tracked>::Type)ind);
+	for (int ind = 0; ind < 100; ind++)
+	{
+		cont.emplace_element(ind);
+		cont.add_element(Tracked(-ind));
+	}
+
+	HeteroContainer<Tracked> moved(std::move(cont));
+	assert(moved.elements_size() == 200 && cont.elements_size() == 0 && cont.containers_size() == 0);
+
+	moved.sort();
+	int previous = -100;
+	size_t visited = 0;
+	for (const Tracked &element : moved)
+	{
+		assert(previous <= element.value);
+		previous = element.value;
+		++visited;
+	}
+	assert(visited == 200);
+
+	assert(Tracked::copies == 0);
+
+	//a batch from vector iterators is copied once, straight into the subcontainers; other ranges go through a copy
+	std::vector<Tracked> batch(50);
+	moved.add_elements(batch.cbegin(), batch.cend());
+	assert(Tracked::copies == 50 && moved.elements_size() == 250);
+	moved.add_elements(batch.rbegin(), batch.rend());
+	assert(Tracked::copies == 150 && moved.elements_size() == 300);
+}
+
+void TestMemoryUsage()
+{
+	Stack<int> stack;
+	DoublyLinkedList<int> list;
+	BinSearchTree<int> tree(true);
+	assert(stack.memory_usage().payload == 0 && stack.memory_usage().overhead == sizeof(stack));
+	for (int ind = 0; ind < 10; ind++)
+	{
+		stack.push(ind);
+		list.push(ind);
+		tree.push(ind);
+	}
+
+	//the buffer grows to 16 slots, the pool to a slab of 16 nodes
+	MemoryUsage usage = stack.memory_usage();
+	assert(usage.payload == 10 * sizeof(int) && usage.slack == 6 * sizeof(int) && usage.overhead == sizeof(stack));
+	usage = list.memory_usage();
+	assert(usage.payload == 10 * sizeof(int) && usage.overhead >= 10 * 2 * sizeof(void*) + sizeof(list));
+	assert(usage.slack > 0 && (usage.total() - sizeof(list)) % 16 == 0);
+	usage = tree.memory_usage();
+	assert(usage.payload == 10 * sizeof(int) && usage.overhead >= 10 * 3 * sizeof(void*) + sizeof(tree) && usage.slack == 0);
+
+	//popped nodes stay in the pool
+	size_t reserved = list.memory_usage().total();
+	while (!list.empty()) list.pop();
+	assert(list.memory_usage().payload == 0 && list.memory_usage().total() == reserved);
+
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 5; ind++) cont.add_container((HeteroContainer<int>::Type)ind);
+	for (int ind = 0; ind < 100; ind++) cont.add_element(ind);
+
+	MemoryUsage parts;
+	for (size_t ind = 0; ind < cont.containers_size(); ind++) parts += cont.container_memory_usage(ind);
+	usage = cont.memory_usage();
+	assert(usage.payload == 100 * sizeof(int) && parts.payload == usage.payload);
+	assert(usage.overhead > parts.overhead && usage.slack >= parts.slack);
+}
+
+void TestMembershipFilters()
+{
+	BloomFilter filter;
+	filter.reset(1000);
+	for (int ind = 0; ind < 1000; ind++) filter.insert(MembershipHash<int>::of(ind));
+	size_t falsePositives = 0;
+	for (int ind = 0; ind < 1000; ind++) assert(filter.may_contain(MembershipHash<int>::of(ind)));
+	for (int ind = 1000; ind < 11000; ind++) falsePositives += filter.may_contain(MembershipHash<int>::of(ind)) ? 1 : 0;
+	assert(falsePositives < 300 && !filter.full());
+
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 5; ind++) cont.add_container((HeteroContainer<int>::Type)ind);
+	cont.use_zone_maps(false); //the filters alone rule the missing elements out
+	cont.use_membership_filters();
+	std::vector<int> batch(300);
+	std::iota(batch.begin(), batch.end(), 0);
+	cont.add_elements(batch.begin(), batch.end());
+	assert(cont.contains(150) && !cont.contains(-1));
+
+	//the filters follow the pushes and grow past the size they were built for
+	for (int ind = 300; ind < 2000; ind++)
+	{
+		if (ind % 2 == 0) cont.add_element(ind);
+		else cont.emplace_element(ind);
+		if (ind % 100 == 0) assert(cont.contains(ind) && !cont.contains(-ind));
+	}
+	for (int ind = 0; ind < 2000; ind++) assert(cont.contains(ind));
+	for (int ind = 2000; ind < 3000; ind++) assert(!cont.contains(ind) && !cont.contains(ind, 4));
+
+	cont.filter([](const int &element) { return element % 2 == 0; });
+	assert(!cont.contains(10) && cont.contains(11) && cont.contains(1999, 4));
+
+	std::stringstream stream;
+	cont.save(stream, HeteroContainer<int>::BINARY);
+	HeteroContainer<int> loaded;
+	loaded.use_membership_filters();
+	loaded.load(stream, HeteroContainer<int>::BINARY);
+	HeteroContainer<int> copy(loaded);
+	assert(loaded.contains(11) && !loaded.contains(10) && copy.contains(1999) && !copy.contains(1998));
+
+	//the filters are part of the memory accounting and are freed when turned off
+	size_t withFilters = copy.memory_usage().overhead;
+	copy.use_membership_filters(false);
+	assert(copy.memory_usage().overhead < withFilters);
+	assert(copy.contains(1999) && !copy.contains(1998));
+}
+
+void TestZoneMaps()
+{
+	//a sorted batch splits into one contiguous range per subcontainer
+	HeteroContainer<int> cont;
+	cont.add_container(HeteroContainer<int>::STACK);
+	cont.add_container(HeteroContainer<int>::QUEUE);
+	cont.add_container(HeteroContainer<int>::LINKED_LIST);
+	cont.add_container(HeteroContainer<int>::BALANCED_BIN_SEARCH_TREE);
+	cont.use_zone_maps();
+	std::vector<int> batch(4000);
+	std::iota(batch.begin(), batch.end(), 0);
+	cont.add_elements(batch.data(), batch.size());
+
+	//stacks and linked lists take the elements to their front, so an ascending batch ends up descending
+	assert(!cont.container_sorted(0) && cont.container_sorted(1) && !cont.container_sorted(2) && cont.container_sorted(3));
+	assert(!cont.is_sorted());
+	cont.sort();
+	assert(cont.is_sorted());
+
+#ifdef HETERO_INSTRUMENTATION
+	cont.reset_instrumentation();
+	assert(cont.contains(1500) && !cont.contains(-1) && !cont.contains(4000));
+	uint64_t probes = 0;
+	for (const auto &snapshot : cont.instrumentation_snapshot().containers) probes += snapshot.counters.containsProbes;
+	assert(probes == 1);
+#endif
+	for (int ind = 0; ind < 4000; ind += 7) assert(cont.contains(ind) && cont.contains(ind, 2));
+	assert(!cont.contains(-1) && !cont.contains(4000) && !cont.contains(4000, 2));
+
+	assert(!(cont.get_element_it(4500) != cont.end()) && *cont.get_element_it(1234) == 1234);
+	std::pair<HeteroContainer<int>::SortIterator, HeteroContainer<int>::SortIterator> range = cont.range(1500, 2500);
+	int expected = 1500;
+	for (HeteroContainer<int>::SortIterator it = range.first; it != range.second; ++it) assert(*it == expected++);
+	assert(expected == 2500);
+	assert(*cont.upper_bound(999) == 1000 && *cont.lower_bound(-100) == 0 && !(cont.upper_bound(3999) != cont.end()));
+
+	//the pushes keep the order when they land on the right end
+	cont.add_element(-5); //the stack
+	cont.add_element(10000); //the back of the queue
+	cont.add_element(-10); //the front of the linked list
+	cont.add_element(5000);
+	assert(cont.is_sorted() && cont.contains(-5) && cont.contains(10000) && cont.contains(-10) && cont.contains(5000));
+	cont.add_element(0);
+	assert(!cont.container_sorted(0) && !cont.is_sorted());
+
+	//filtering leaves the bounds stale until the next lookup
+	cont.filter([](const int &element) { return element < 1000; });
+	assert(!cont.contains(0) && !cont.contains(-5) && cont.contains(1000) && cont.contains(10000));
+	assert(cont.container_sorted(0));
+
+	cont.use_zone_maps(false);
+	assert(!cont.container_sorted(1) && cont.contains(1000) && !cont.contains(999));
+}
+
+void TestHeteroSortIterator()
+{
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 37; ind++) cont.add_container((HeteroContainer<int>::Type)(ind % 5));
+
+	std::vector<int> expected;
+	for (int ind = 0; ind < 1000; ind++)
+	{
+		int number = (ind * 7919) % 523 - 200;
+		cont.add_element(number);
+		expected.push_back(number);
+	}
+	std::sort(expected.begin(), expected.end());
+
+	cont.sort();
+	size_t ind = 0;
+	for (int element : cont)
+	{
+		assert(expected[ind] == element);
+
+		++ind;
+	}
+	assert(ind == expected.size());
+
+	HeteroContainer<int> copy = cont;
+	copy.filter([](const int &number) { return number < 0; });
+	for (int number = 0; number < 100; number++) copy.add_element(number);
+	size_t negatives = std::count_if(expected.begin(), expected.end(), [](int number) { return number < 0; });
+	assert(copy.elements_size() == cont.elements_size() - negatives + 100);
+
+	HeteroContainer<int> empty;
+	empty.add_container(HeteroContainer<int>::QUEUE);
+	assert(!(empty.begin() != empty.end()));
+
+	//every element goes to the smallest subcontainer, the first one on ties
+	HeteroContainer<int> balanced;
+	for (int ind = 0; ind < 3; ind++) balanced.add_container(HeteroContainer<int>::STACK);
+	for (int ind = 0; ind < 4; ind++) balanced.add_element(ind);
+	assert(balanced.container_size(0) == 2 && balanced.container_size(1) == 1 && balanced.container_size(2) == 1);
+	balanced.add_container(HeteroContainer<int>::QUEUE);
+	balanced.add_element(4);
+	assert(balanced.container_size(3) == 1);
+	balanced.add_element(5);
+	assert(balanced.container_size(1) == 2 && balanced.container_size(2) == 1 && balanced.container_size(3) == 1);
+	balanced.filter([](const int &number) { return number < 2; });
+	balanced.add_element(6);
+	assert(balanced.container_size(0) == 2 && balanced.container_size(1) == 1 && balanced.elements_size() == 5);
+}
+
+void TestHeteroRange()
+{
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 13; ind++) cont.add_container((HeteroContainer<int>::Type)(ind % 5));
+	std::vector<int> expected;
+	for (int ind = 0; ind < 3000; ind++)
+	{
+		int element = (ind * 7919) % 1009 - 500;
+		if (element % 4 == 0) continue; //leaves gaps to look up
+		cont.add_element(element);
+		expected.push_back(element);
+	}
+	cont.sort();
+	std::sort(expected.begin(), expected.end());
+
+	for (int element = -510; element <= 510; element += 3)
+	{
+		auto bound = std::lower_bound(expected.begin(), expected.end(), element);
+		auto it = cont.lower_bound(element);
+		for (auto crr = bound; crr != expected.end() && crr - bound < 20; ++crr, ++it) assert(it != cont.end() && *it == *crr);
+
+		auto equal = cont.equal_range(element);
+		size_t amount = 0;
+		for (; equal.first != equal.second; ++equal.first, ++amount) assert(*equal.first == element);
+		assert(amount == (size_t)std::count(expected.begin(), expected.end(), element));
+		assert((cont.get_element_it(element) != cont.end()) == (amount != 0));
+	}
+
+	//a merge started at a bound meets the one started from the beginning
+	auto it = cont.begin();
+	auto bound = cont.lower_bound(7);
+	for (size_t ind = 0; expected[ind] < 7; ind++, ++it) assert(it != bound);
+	assert(!(it != bound));
+
+	auto window = cont.range(-100, 100);
+	size_t amount = 0;
+	for (; window.first != window.second; ++window.first, ++amount) assert(*window.first >= -100 && *window.first < 100);
+	assert(amount == (size_t)(std::lower_bound(expected.begin(), expected.end(), 100) - std::lower_bound(expected.begin(), expected.end(), -100)));
+	assert(!(cont.lower_bound(1000) != cont.end()));
+}
+
+void TestHeteroParallel()
+{
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 16; ind++) cont.add_container((HeteroContainer<int>::Type)(ind % 5));
+	for (int ind = 0; ind < 20000; ind++) cont.add_element((ind * 7919) % 10007);
+
+	HeteroContainer<int> serial = cont;
+	serial.sort();
+	cont.sort(4);
+
+	HeteroContainer<int>::SortIterator serialIt = serial.begin();
+	for (int element : cont)
+	{
+		assert(serialIt != serial.end());
+		assert(*serialIt == element);
+
+		++serialIt;
+	}
+	assert(!(serialIt != serial.end()));
+
+	assert(cont.contains(7919, 4) && !cont.contains(10007, 4));
+	assert(cont.contains([](const int &number) { return number > 10000; }, 4));
+	assert(!cont.contains([](const int &number) { return number < 0; }, 4));
+
+	cont.filter([](const int &number) { return number % 2 == 0; }, 4);
+	serial.filter([](const int &number) { return number % 2 == 0; });
+	assert(cont.elements_size() == serial.elements_size());
+	assert(!cont.contains([](const int &number) { return number % 2 == 0; }, 4));
+}
+
+template <typename T>
+std::string to_text(const HeteroContainer<T> &cont)
+{
+	std::ostringstream text;
+	cont.save(text);
+
+	return text.str();
+}
+
+void TestStaticHetero()
+{
+	HeteroContainer<int> dynamic;
+	StaticHeteroContainer<int> fixed;
+	for (int ind = 0; ind < 17; ind++)
+	{
+		dynamic.add_container((HeteroContainer<int>::Type)(ind % 5));
+		fixed.add_container((HeteroContainer<int>::Type)(ind % 5));
+	}
+	for (int ind = 0; ind < 2000; ind++)
+	{
+		dynamic.add_element((ind * 7919) % 1009 - 500);
+		fixed.add_element((ind * 7919) % 1009 - 500);
+	}
+
+	assert(fixed.elements_size() == 2000 && fixed.containers_size() == 17);
+	assert(fixed.container_type(3) == HeteroContainer<int>::BIN_SEARCH_TREE && fixed.container_type(4) == HeteroContainer<int>::BALANCED_BIN_SEARCH_TREE);
+	assert(fixed.contains(-500) && !fixed.contains(600));
+
+	int limit = 490;
+	fixed.filter([limit](const int &number) { return number > limit || number < -limit; });
+	dynamic.filter([limit](const int &number) { return number > limit || number < -limit; });
+	assert(fixed.elements_size() == dynamic.elements_size() && !fixed.contains([limit](const int &number) { return number > limit; }));
+
+	long long sum = 0;
+	fixed.for_each([&sum](const int &number) { sum += number; });
+	assert(sum == std::accumulate(dynamic.begin(), dynamic.end(), 0LL));
+
+	fixed.sort();
+	dynamic.sort();
+	std::vector<int> expected, actual;
+	for (auto it = dynamic.begin(); it != dynamic.end(); ++it) expected.push_back(*it);
+	for (auto it = fixed.begin(); it != fixed.end(); ++it) actual.push_back(*it);
+	assert(actual == expected && std::is_sorted(actual.begin(), actual.end()));
+
+	fixed.add_element(1000);
+	assert(fixed.elements_size() == expected.size() + 1 && fixed.contains(1000));
+}
+
+void TestHeteroSerialization()
+{
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 10; ind++) cont.add_container((HeteroContainer<int>::Type)(ind % 5));
+	for (int ind = 0; ind < 1000; ind++) cont.add_element((ind * 7919) % 1009 - 500);
+
+	std::stringstream binary(std::ios::in | std::ios::out | std::ios::binary);
+	cont.save(binary, HeteroContainer<int>::BINARY);
+	std::string snapshot = binary.str();
+
+	HeteroContainer<int> loaded;
+	loaded.load(binary, HeteroContainer<int>::BINARY);
+	assert(binary && loaded.elements_size() == 1000);
+	assert(loaded.containers_size() == 10);
+	cont.sort(); //stacks and linked lists are reversed by loading, the same as with the text format
+	loaded.sort();
+	assert(to_text(loaded) == to_text(cont));
+
+	snapshot[snapshot.size() / 2] ^= 1;
+	std::stringstream corrupted(snapshot, std::ios::in | std::ios::binary);
+	loaded.load(corrupted, HeteroContainer<int>::BINARY);
+	assert(!corrupted && loaded.elements_size() == 1000);
+
+	HeteroContainer<std::string> words;
+	words.add_container(HeteroContainer<std::string>::QUEUE);
+	words.add_container(HeteroContainer<std::string>::BALANCED_BIN_SEARCH_TREE);
+	words.add_element("heterogeneous container");
+	words.add_element("");
+	words.add_element("binary");
+
+	std::stringstream wordsBinary(std::ios::in | std::ios::out | std::ios::binary);
+	words.save(wordsBinary, HeteroContainer<std::string>::BINARY);
+	HeteroContainer<std::string> loadedWords;
+	loadedWords.load(wordsBinary, HeteroContainer<std::string>::BINARY);
+	assert(wordsBinary && loadedWords.elements_size() == 3);
+	assert(loadedWords.contains("heterogeneous container") && loadedWords.contains(""));
+
+	//a header with huge counts or lengths fails the load before anything that large is allocated
+	HeteroContainer<int> single;
+	single.add_container(HeteroContainer<int>::QUEUE);
+	single.add_element(7);
+	std::stringstream singleBinary(std::ios::in | std::ios::out | std::ios::binary);
+	single.save(singleBinary, HeteroContainer<int>::BINARY);
+	std::string wordsSnapshot = wordsBinary.str();
+
+	uint64_t corruptions[][2] = { { 1ULL << 40, 1ULL << 42 }, { 1ULL << 62, 0 }, { 1, UINT64_MAX - 3 } };
+	for (const uint64_t *corruption : corruptions)
+	{
+		std::string entry;
+		BinaryFormat::append(entry, corruption[0], 8);
+		BinaryFormat::append(entry, corruption[1], 8);
+
+		std::string corruptedSnapshot = singleBinary.str();
+		corruptedSnapshot.replace(BinaryFormat::HEADER_SIZE + 8, 16, entry);
+		std::stringstream corruptedHeader(corruptedSnapshot, std::ios::in | std::ios::binary);
+		loaded.load(corruptedHeader, HeteroContainer<int>::BINARY);
+		assert(!corruptedHeader && loaded.elements_size() == 1000);
+
+		corruptedSnapshot = wordsSnapshot;
+		corruptedSnapshot.replace(BinaryFormat::HEADER_SIZE + 8, 16, entry);
+		std::stringstream corruptedWords(corruptedSnapshot, std::ios::in | std::ios::binary);
+		loadedWords.load(corruptedWords, HeteroContainer<std::string>::BINARY);
+		assert(!corruptedWords && loadedWords.elements_size() == 3);
+	}
+}
+
+void TestHeteroMappedLoad()
+{
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 8; ind++) cont.add_container((HeteroContainer<int>::Type)(ind % 4));
+	cont.add_container(HeteroContainer<int>::BALANCED_BIN_SEARCH_TREE);
+	for (int ind = 0; ind < 1000; ind++) cont.add_element((ind * 7919) % 1009 - 500);
+
+	const char *fileName = "mapped_snapshot.bin";
+	std::ofstream outFile(fileName, std::ios::binary);
+	cont.save(outFile, HeteroContainer<int>::BINARY);
+	outFile.close();
+
+	std::ifstream inpFile(fileName, std::ios::binary);
+	HeteroContainer<int> loaded;
+	loaded.load(inpFile, HeteroContainer<int>::BINARY);
+	inpFile.close();
+
+	HeteroContainer<int> mapped;
+	assert(mapped.load_mapped(fileName, true));
+	assert(mapped.elements_size() == 1000 && mapped.containers_size() == 9);
+	assert(mapped.contains(-500) && !mapped.contains(1000));
+
+	std::vector<int> expected, actual;
+	for (auto it = loaded.begin(); it != loaded.end(); ++it) expected.push_back(*it);
+	for (auto it = mapped.begin(); it != mapped.end(); ++it) actual.push_back(*it);
+	assert(actual == expected);
+
+	//the walks, seeks and lookups are answered from the mapped bytes, so the views are not copied
+	size_t mappedBytes = mapped.memory_usage().total();
+	assert(*mapped.lower_bound(0) == *loaded.lower_bound(0) && *mapped.upper_bound(-1) == *loaded.upper_bound(-1));
+	assert(*mapped.get_element_it(-500) == -500 && !(mapped.get_element_it(1000) != mapped.end()));
+	auto mappedWindow = mapped.range(-100, 100);
+	auto loadedWindow = loaded.range(-100, 100);
+	for (; mappedWindow.first != mappedWindow.second; ++mappedWindow.first, ++loadedWindow.first) assert(*mappedWindow.first == *loadedWindow.first);
+	assert(!(loadedWindow.first != loadedWindow.second));
+	std::istringstream mappedText(to_text(mapped));
+	HeteroContainer<int> reloaded;
+	mappedText >> reloaded;
+	assert(mappedText && reloaded.elements_size() == 1000 && reloaded.contains(-500));
+	assert(mapped.memory_usage().total() == mappedBytes);
+
+	//the views are written to like regular subcontainers
+	mapped.add_element(1000);
+	loaded.add_element(1000);
+	mapped.filter([](const int &element) { return element % 3 == 0; });
+	loaded.filter([](const int &element) { return element % 3 == 0; });
+	mapped.sort();
+	loaded.sort();
+	assert(to_text(mapped) == to_text(loaded));
+
+	HeteroContainer<int> copy(mapped);
+	assert(copy.elements_size() == loaded.elements_size());
+
+	assert(!mapped.load_mapped("missing_snapshot.bin") && mapped.elements_size() == loaded.elements_size());
+	std::remove(fileName);
+}
+
+#ifdef HETERO_INSTRUMENTATION
+void TestInstrumentation()
+{
+	Instrumentation::Histogram histogram;
+	for (uint64_t value = 1; value <= 1000; value++) histogram.record(value);
+	assert(histogram.count() == 1000 && histogram.min() == 1 && histogram.max() == 1000);
+	assert(histogram.percentile(50) >= 500 && histogram.percentile(50) <= 500 + 500 / 16);
+	assert(histogram.percentile(100) == 1000 && histogram.percentile(0) == 1);
+	uint64_t recorded = 0;
+	histogram.for_each_bucket([&recorded](uint64_t lowest, uint64_t highest, uint64_t count) { assert(lowest <= highest); recorded += count; });
+	assert(recorded == 1000);
+
+	//a container used as storage charges its work to its owner, and an operation is counted once
+	Stack<int, DoublyLinkedList<int>> stack;
+	for (int ind = 0; ind < 5; ind++) stack.push(ind);
+	stack.pop();
+	assert(stack.counters().pushes == 5 && stack.counters().pops == 1 && stack.counters().nodeAllocations == 5);
+
+	HeteroContainer<int> cont;
+	for (int ind = 0; ind < 5; ind++) cont.add_container((HeteroContainer<int>::Type)ind);
+	std::vector<int> batch;
+	for (int ind = 0; ind < 50; ind++) batch.push_back(50 - ind);
+	cont.add_elements(batch.begin(), batch.end());
+	cont.add_element(100);
+
+	assert(!cont.contains(-1));
+	assert(!cont.contains([](const int &element) { return element < 0; }));
+	cont.sort();
+	cont.filter([](const int &element) { return element % 2 == 0; });
+
+	HeteroContainer<int>::InstrumentationSnapshot snapshot = cont.instrumentation_snapshot();
+	assert(snapshot.containers.size() == 5);
+	for (size_t ind = 0; ind < 5; ind++)
+	{
+		const Instrumentation::Counters &counters = snapshot.containers[ind].counters;
+		size_t pushed = ind == 0 ? 11 : 10;
+		assert(snapshot.containers[ind].type == (HeteroContainer<int>::Type)ind);
+		assert(counters.pushes == pushed && counters.pops == 0 && counters.containsProbes == 2);
+		assert(counters.comparisons > 0);
+		//every element is tested once by contains and once by filter
+		assert(counters.predicateEvaluations == 2 * pushed);
+		if (ind >= HeteroContainer<int>::LINKED_LIST) assert(counters.nodeAllocations == pushed);
+	}
+	assert(snapshot.latencies.sort.count() == 1 && snapshot.latencies.filter.count() == 1);
+
+	std::stringstream stream;
+	cont.save(stream, HeteroContainer<int>::BINARY);
+	cont.load(stream, HeteroContainer<int>::BINARY);
+	snapshot = cont.instrumentation_snapshot();
+	assert(snapshot.latencies.save.count() == 1 && snapshot.latencies.load.count() == 1);
+	assert(snapshot.latencies.sort.count() == 1);
+
+	cont.reset_instrumentation();
+	snapshot = cont.instrumentation_snapshot();
+	assert(snapshot.latencies.sort.count() == 0 && snapshot.containers[0].counters.pushes == 0);
+}
+#endif
+
 void ExecuteTests()
 {
 	TestStack();
 	TestQueue();
+	TestDoublyLinkedList();
 	TestBinSearchTree();
+	TestBalancedBinSearchTree();
+	TestOrderStatistics();
+	TestPredicates();
 	TestHetero();
+	TestHeteroBulkLoad();
+	TestMoveSemantics();
+	TestMemoryUsage();
+	TestMembershipFilters();
+	TestZoneMaps();
+	TestHeteroSortIterator();
+	TestHeteroParallel();
+	TestHeteroRange();
+	TestStaticHetero();
+	TestHeteroSerialization();
+	TestHeteroMappedLoad();
+#ifdef HETERO_INSTRUMENTATION
+	TestInstrumentation();
+#endif
 }
\ No newline at end of file